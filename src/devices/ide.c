@@ -34,6 +34,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +50,13 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+
+/* Most sectors to transfer per interrupt with READ MULTIPLE and
+   WRITE MULTIPLE.  One page. */
+#define MULTIPLE_MAX 8
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +65,8 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    int multiple;               /* Sectors per interrupt in READ and
+                                   WRITE MULTIPLE, or 0 if unused. */
   };
 
 /* An ATA channel (aka controller).
@@ -85,7 +95,10 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void set_multiple_mode (struct ata_disk *, const char *id);
+static void select_sector (struct ata_disk *, block_sector_t, size_t cnt);
+static void transfer_sectors (struct channel *, uint8_t *, size_t cnt,
+                              bool write);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -136,6 +149,7 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->multiple = 0;
         }
 
       /* Register interrupt handler. */
@@ -303,6 +317,8 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
+  set_multiple_mode (d, id);
+
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
@@ -337,6 +353,74 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
+/* Transfers CNT sectors starting at SEC_NO between disk D and
+   BUFFER, reading if WRITE is false, with as few commands and
+   interrupts as the disk allows.  Panics on error. */
+static void
+ide_transfer (struct ata_disk *d, block_sector_t sec_no, uint8_t *buffer,
+              size_t cnt, bool write)
+{
+  struct channel *c = d->channel;
+
+  lock_acquire (&c->lock);
+  while (cnt > 0)
+    {
+      /* One command transfers at most 256 sectors. */
+      size_t chunk = cnt < 256 ? cnt : 256;
+      bool multiple = d->multiple > 1 && chunk > 1;
+      size_t block = multiple ? (size_t) d->multiple : 1;
+      size_t left = chunk;
+      uint8_t *p = buffer;
+      bool ok = true;
+
+      select_sector (d, sec_no, chunk);
+      if (write)
+        {
+          issue_pio_command (c, (multiple ? CMD_WRITE_MULTIPLE
+                                 : CMD_WRITE_SECTOR_RETRY));
+          ok = wait_while_busy (d);
+        }
+      else
+        issue_pio_command (c, (multiple ? CMD_READ_MULTIPLE
+                               : CMD_READ_SECTOR_RETRY));
+
+      /* A write interrupts once the disk has accepted each block
+         we send it, a read once each block is ready for us. */
+      while (ok && left > 0)
+        {
+          size_t n = left < block ? left : block;
+
+          if (write)
+            {
+              transfer_sectors (c, p, n, true);
+              p += n * BLOCK_SECTOR_SIZE;
+              left -= n;
+            }
+          sema_down (&c->completion_wait);
+          if (!write)
+            {
+              ok = wait_while_busy (d);
+              if (ok)
+                {
+                  transfer_sectors (c, p, n, false);
+                  p += n * BLOCK_SECTOR_SIZE;
+                  left -= n;
+                }
+            }
+          else if (left > 0)
+            ok = wait_while_busy (d);
+        }
+      if (!ok)
+        PANIC ("%s: disk %s failed, sector=%"PRDSNu,
+               d->name, write ? "write" : "read", sec_no);
+
+      sec_no += chunk;
+      buffer += chunk * BLOCK_SECTOR_SIZE;
+      cnt -= chunk;
+    }
+  lock_release (&c->lock);
+}
+
 /* Reads sector SEC_NO from disk D into BUFFER, which must have
    room for BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to disks, so external
@@ -344,16 +428,7 @@ descramble_ata_string (char *string, int size)
 static void
 ide_read (void *d_, block_sector_t sec_no, void *buffer)
 {
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
-  lock_release (&c->lock);
+  ide_transfer (d_, sec_no, buffer, 1, false);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -364,36 +439,71 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
 static void
 ide_write (void *d_, block_sector_t sec_no, const void *buffer)
 {
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  lock_release (&c->lock);
+  ide_transfer (d_, sec_no, (uint8_t *) buffer, 1, true);
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER. */
+static void
+ide_read_multiple (void *d_, block_sector_t sec_no, void *buffer,
+                   size_t cnt)
+{
+  ide_transfer (d_, sec_no, buffer, cnt, false);
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER. */
+static void
+ide_write_multiple (void *d_, block_sector_t sec_no, const void *buffer,
+                    size_t cnt)
+{
+  ide_transfer (d_, sec_no, (uint8_t *) buffer, cnt, true);
 }
 
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple
   };
-
+
+/* Enables READ MULTIPLE and WRITE MULTIPLE on disk D, whose
+   IDENTIFY DEVICE data is ID, so that a page-sized transfer
+   takes a single interrupt, if D supports them. */
+static void
+set_multiple_mode (struct ata_disk *d, const char *id)
+{
+  struct channel *c = d->channel;
+  int max = *(const uint16_t *) &id[47 * 2] & 0xff;
+  int multiple;
+
+  for (multiple = MULTIPLE_MAX; multiple > 1; multiple /= 2)
+    if (multiple <= max)
+      break;
+  if (multiple <= 1)
+    return;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), multiple);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if (!(inb (reg_status (c)) & STA_ERR))
+    d->multiple = multiple;
+}
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the sector count CNT, at most 256, to the
+   disk's sector selection registers.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= 256);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt & 0xff);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -525,3 +635,19 @@ interrupt_handler (struct intr_frame *f)
 }
 
 
+
+/* Moves CNT sectors between channel C's data register and
+   BUFFER, writing to the disk if WRITE is true.  Must be called
+   by the thread that issued the command, since BUFFER may be a
+   user address. */
+static void
+transfer_sectors (struct channel *c, uint8_t *buffer, size_t cnt, bool write)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++, buffer += BLOCK_SECTOR_SIZE)
+    if (write)
+      output_sector (c, buffer);
+    else
+      input_sector (c, buffer);
+}
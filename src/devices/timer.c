@@ -24,26 +24,94 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* TSC clock.  The time-stamp counter is read at each timer
+   interrupt, and timer_ns() interpolates between interrupts by
+   the number of TSC cycles per tick measured in timer_calibrate().
+   Until then, tsc_per_tick is 0 and timer_ns() only has tick
+   resolution. */
+#define TSC_CALIBRATE_TICKS 5
+static uint64_t tick_tsc;       /* TSC at the last timer interrupt. */
+static uint64_t tsc_per_tick;   /* TSC cycles per timer tick. */
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+read_tsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Timer interrupt latency.  The PIT fires every tsc_per_tick
+   cycles, so any time between two timer interrupts beyond that is
+   time the second one waited with interrupts off, e.g. behind a
+   long interrupt handler. */
+static uint64_t late_cycles;     /* Total lateness. */
+static uint64_t late_max_cycles; /* Worst lateness. */
+static int64_t late_cnt;         /* Ticks later than 1/10 tick. */
+
+/* Hierarchical timing wheel of sleeping threads, keyed on their
+   time_to_wake.  Level L has WHEEL_SIZE slots, each covering
+   WHEEL_SIZE**L ticks, so a sleep of up to WHEEL_SIZE**WHEEL_LEVELS
+   ticks is inserted in constant time.  Longer sleeps wait in
+   wheel_overflow.
+
+   Each tick expires the threads in one level-0 slot.  Whenever
+   the level-0 index wraps around, the next level-1 slot is
+   "cascaded": its threads are re-inserted into lower levels,
+   and so on up the hierarchy.  A thread is cascaded at most once
+   per level, so the work per tick is proportional to the number
+   of threads woken, amortized.
+
+   Threads that wake on the same tick are woken in no particular
+   order: a thread cascaded down from a higher level lands behind
+   any thread that was filed directly into the same level-0 slot,
+   even if it went to sleep first. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static struct list wheel_overflow;
+
+/* Next tick whose level-0 slot has to be processed.  All sleeping
+   threads are filed relative to this time. */
+static int64_t wheel_ticks;
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void wheel_insert (struct thread *);
+static void wheel_cascade (int level, int slot);
+static void wheel_advance (void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
+  int level, slot;
+
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (slot = 0; slot < WHEEL_SIZE; slot++)
+      list_init (&wheel[level][slot]);
+  list_init (&wheel_overflow);
+  wheel_ticks = ticks;
+
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays,
+   and tsc_per_tick, used by timer_ns(). */
 void
 timer_calibrate (void) 
 {
   unsigned high_bit, test_bit;
+  uint64_t start_tsc;
+  int64_t start;
 
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
@@ -63,7 +131,19 @@ timer_calibrate (void)
     if (!too_many_loops (high_bit | test_bit))
       loops_per_tick |= test_bit;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  printf ("%'"PRIu64" loops/s", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  /* Count TSC cycles over a few whole ticks. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+  start_tsc = tick_tsc;
+  start = ticks;
+  while (ticks < start + TSC_CALIBRATE_TICKS)
+    barrier ();
+  tsc_per_tick = (tick_tsc - start_tsc) / TSC_CALIBRATE_TICKS;
+
+  printf (", %'"PRIu64" TSC cycles/s.\n", tsc_per_tick * TIMER_FREQ);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -76,6 +156,29 @@ timer_ticks (void)
   return t;
 }
 
+/* Returns the number of nanoseconds since the OS booted, with
+   sub-tick resolution from the TSC once timer_calibrate() has
+   run.  The time within a tick is capped just short of the next
+   tick, so the result never runs backward even if the timer
+   interrupt is late. */
+int64_t
+timer_ns (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  int64_t t = ticks;
+  uint64_t cycles = read_tsc () - tick_tsc;
+  int64_t ns = t * NSEC_PER_TICK;
+  intr_set_level (old_level);
+
+  if (tsc_per_tick != 0)
+    {
+      if (cycles >= tsc_per_tick)
+        cycles = tsc_per_tick - 1;
+      ns += cycles * NSEC_PER_TICK / tsc_per_tick;
+    }
+  return ns;
+}
+
 /* Returns the number of timer ticks elapsed since THEN, which
    should be a value once returned by timer_ticks(). */
 int64_t
@@ -84,13 +187,6 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
-static bool
-thread_lower_wake(struct list_elem *a, struct list_elem *b, void* aux){
-  struct thread* a_thread = list_entry(a, struct thread, sleepelem);
-  struct thread* b_thread = list_entry(b, struct thread, sleepelem);
-  return a_thread->time_to_wake < b_thread->time_to_wake;
-}
-
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
@@ -105,12 +201,112 @@ timer_sleep (int64_t new_ticks)
   enum intr_level old_level = intr_disable();
   struct thread *cur = thread_current ();
   cur->time_to_wake = time_waking;
-  list_insert_ordered(&sleep_list, &cur->sleepelem,thread_lower_wake, NULL);
+  wheel_insert (cur);
   sema_down(&cur->sema);
 
   intr_set_level(old_level);
-  //while (timer_elapsed (start) < ticks) 
-  //  thread_yield ();
+}
+
+/* Wakes up thread T early if it is sleeping in timer_sleep(),
+   removing it from the timing wheel.  Returns true if T was
+   sleeping, false otherwise. */
+bool
+timer_cancel_sleep (struct thread *t) 
+{
+  enum intr_level old_level = intr_disable ();
+  bool sleeping = t->time_to_wake >= 0;
+
+  if (sleeping)
+    {
+      list_remove (&t->sleepelem);
+      t->time_to_wake = -1;
+      sema_up (&t->sema);
+    }
+  intr_set_level (old_level);
+  return sleeping;
+}
+
+/* Files sleeping thread T in the timing wheel slot for its
+   time_to_wake.  Interrupts must be off. */
+static void
+wheel_insert (struct thread *t) 
+{
+  int64_t delta = t->time_to_wake - wheel_ticks;
+  int level;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Already due: expire on the next tick processed. */
+  if (delta < 0)
+    {
+      list_push_back (&wheel[0][wheel_ticks & WHEEL_MASK], &t->sleepelem);
+      return;
+    }
+
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
+      {
+        int slot = (t->time_to_wake >> (WHEEL_BITS * level)) & WHEEL_MASK;
+        list_push_back (&wheel[level][slot], &t->sleepelem);
+        return;
+      }
+  list_push_back (&wheel_overflow, &t->sleepelem);
+}
+
+/* Re-files the threads in SLOT of LEVEL into lower levels. */
+static void
+wheel_cascade (int level, int slot) 
+{
+  struct list pending;
+
+  list_init (&pending);
+  while (!list_empty (&wheel[level][slot]))
+    list_push_back (&pending, list_pop_front (&wheel[level][slot]));
+  while (!list_empty (&pending))
+    wheel_insert (list_entry (list_pop_front (&pending),
+                              struct thread, sleepelem));
+}
+
+/* Processes every tick of the timing wheel up to the current
+   time, waking the threads whose time has come.  Runs in the
+   timer interrupt. */
+static void
+wheel_advance (void) 
+{
+  while (wheel_ticks <= ticks)
+    {
+      int slot = wheel_ticks & WHEEL_MASK;
+      struct list *expired = &wheel[0][slot];
+      int level;
+
+      /* When a level's index wraps around, pull the next slot of
+         the level above down into it. */
+      for (level = 1; slot == 0 && level < WHEEL_LEVELS; level++)
+        {
+          slot = (wheel_ticks >> (WHEEL_BITS * level)) & WHEEL_MASK;
+          wheel_cascade (level, slot);
+        }
+      if (slot == 0 && level == WHEEL_LEVELS)
+        {
+          struct list pending;
+
+          list_init (&pending);
+          while (!list_empty (&wheel_overflow))
+            list_push_back (&pending, list_pop_front (&wheel_overflow));
+          while (!list_empty (&pending))
+            wheel_insert (list_entry (list_pop_front (&pending),
+                                      struct thread, sleepelem));
+        }
+
+      while (!list_empty (expired))
+        {
+          struct thread *t = list_entry (list_pop_front (expired),
+                                         struct thread, sleepelem);
+          t->time_to_wake = -1;
+          sema_up (&t->sema);
+        }
+      wheel_ticks++;
+    }
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -181,14 +377,33 @@ void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (tsc_per_tick != 0)
+    printf ("Timer: interrupts late by %"PRIu64" ns avg, %"PRIu64" ns max, "
+            "%"PRId64" by over 1/10 tick\n",
+            late_cycles / (uint64_t) timer_ticks ()
+            * NSEC_PER_TICK / tsc_per_tick,
+            late_max_cycles * NSEC_PER_TICK / tsc_per_tick, late_cnt);
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  uint64_t now = read_tsc ();
+
+  if (tsc_per_tick != 0 && now - tick_tsc > tsc_per_tick)
+    {
+      uint64_t late = now - tick_tsc - tsc_per_tick;
+      late_cycles += late;
+      if (late > late_max_cycles)
+        late_max_cycles = late;
+      if (late > tsc_per_tick / 10)
+        late_cnt++;
+    }
+  tick_tsc = now;
   ticks++;
   thread_tick ();
+  wheel_advance ();
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
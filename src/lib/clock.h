@@ -0,0 +1,18 @@
+#ifndef __LIB_CLOCK_H
+#define __LIB_CLOCK_H
+
+#include <stdint.h>
+
+/* Clocks readable with the clock_gettime system call. */
+typedef int clockid_t;
+#define CLOCK_REALTIME 0        /* Wall-clock time since the Epoch. */
+#define CLOCK_MONOTONIC 1       /* Time since boot. */
+
+/* A time, as returned by clock_gettime. */
+struct timespec
+  {
+    int64_t tv_sec;             /* Seconds. */
+    int32_t tv_nsec;            /* Nanoseconds, 0 to 999,999,999. */
+  };
+
+#endif /* lib/clock.h */
@@ -0,0 +1,21 @@
+#ifndef __LIB_SCHED_STATS_H
+#define __LIB_SCHED_STATS_H
+
+#include <stdint.h>
+
+/* Per-thread scheduler accounting, kept by the kernel in each
+   thread and returned to user programs by the schedstat system
+   call.  Times are in timer ticks, except RUN_NS, which is
+   measured at each context switch with the TSC clock. */
+struct sched_stats
+  {
+    int64_t run_ticks;          /* Ticks spent running. */
+    int64_t run_ns;             /* Nanoseconds spent running. */
+    int64_t ready_ticks;        /* Ticks spent READY, waiting to run. */
+    int64_t blocked_ticks;      /* Ticks spent BLOCKED. */
+    int64_t sched_cnt;          /* Times dispatched onto the CPU. */
+    int64_t voluntary_cnt;      /* Switches away while blocking. */
+    int64_t involuntary_cnt;    /* Switches away while still runnable. */
+  };
+
+#endif /* lib/sched-stats.h */
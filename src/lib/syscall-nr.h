@@ -28,7 +28,19 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_SCHEDSTAT,              /* Reads a thread's scheduler statistics. */
+    SYS_FUTEX_WAIT,             /* Waits while a user word has a value. */
+    SYS_FUTEX_WAKE,             /* Wakes threads waiting on a user word. */
+    SYS_THREAD_CREATE,          /* Starts a thread in this process. */
+    SYS_THREAD_JOIN,            /* Waits for a thread to exit. */
+    SYS_THREAD_EXIT,            /* Ends the calling thread. */
+    SYS_SET_DEADLINE,           /* Joins the EDF scheduling class. */
+    SYS_SET_TICKETS,            /* Sets a thread's stride tickets. */
+    SYS_CLOCK_GETTIME,          /* Reads a clock. */
+    SYS_FORK                    /* Copies the current process. */
   };
 
 #endif /* lib/syscall-nr.h */
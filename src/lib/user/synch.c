@@ -0,0 +1,131 @@
+#include <synch.h>
+#include <debug.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* Atomically replaces *P by NEW if it equals OLD.  Returns the
+   previous value of *P. */
+static inline int
+atomic_cmpxchg (int *p, int old, int new)
+{
+  int prev;
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p)
+                : "r" (new), "0" (old)
+                : "memory");
+  return prev;
+}
+
+/* Atomically stores V into *P and returns the previous value. */
+static inline int
+atomic_xchg (int *p, int v)
+{
+  asm volatile ("xchgl %0, %1" : "+r" (v), "+m" (*p) : : "memory");
+  return v;
+}
+
+/* Atomically adds V to *P and returns the previous value. */
+static inline int
+atomic_fetch_add (int *p, int v)
+{
+  asm volatile ("lock xaddl %0, %1" : "+r" (v), "+m" (*p) : : "memory");
+  return v;
+}
+
+/* Initializes M as unlocked. */
+void
+mutex_init (struct mutex *m)
+{
+  m->state = 0;
+}
+
+/* Acquires M, sleeping until it is available if necessary. */
+void
+mutex_lock (struct mutex *m)
+{
+  int c = atomic_cmpxchg (&m->state, 0, 1);
+  if (c == 0)
+    return;
+
+  /* Contended.  Mark M as having waiters, so that the holder
+     wakes us, and sleep until we find it unlocked. */
+  if (c != 2)
+    c = atomic_xchg (&m->state, 2);
+  while (c != 0)
+    {
+      futex_wait (&m->state, 2);
+      c = atomic_xchg (&m->state, 2);
+    }
+}
+
+/* Acquires M if it is unlocked.  Returns true if successful,
+   false if M is held. */
+bool
+mutex_trylock (struct mutex *m)
+{
+  return atomic_cmpxchg (&m->state, 0, 1) == 0;
+}
+
+/* Releases M, which must be held by the caller, and wakes a
+   waiter if there may be one. */
+void
+mutex_unlock (struct mutex *m)
+{
+  if (atomic_fetch_add (&m->state, -1) != 1)
+    {
+      m->state = 0;
+      futex_wake (&m->state, 1);
+    }
+}
+
+/* Initializes CV. */
+void
+condvar_init (struct condvar *cv)
+{
+  cv->seq = 0;
+  cv->waiters = 0;
+}
+
+/* Atomically releases M and waits for CV to be signaled, then
+   reacquires M.  M must be held.  As with kernel condition
+   variables, the caller must recheck its condition afterward. */
+void
+condvar_wait (struct condvar *cv, struct mutex *m)
+{
+  int seq = cv->seq;
+
+  cv->waiters++;
+  mutex_unlock (m);
+
+  /* If a signal bumps SEQ after we read it, futex_wait() returns
+     at once instead of sleeping through it. */
+  futex_wait (&cv->seq, seq);
+
+  /* Other threads may still be sleeping on CV, so take M in the
+     contended state to make sure our unlock wakes one of them. */
+  if (atomic_xchg (&m->state, 2) != 0)
+    mutex_lock (m);
+  cv->waiters--;
+}
+
+/* Wakes one thread waiting on CV.  M must be held. */
+void
+condvar_signal (struct condvar *cv, struct mutex *m UNUSED)
+{
+  if (cv->waiters > 0)
+    {
+      atomic_fetch_add (&cv->seq, 1);
+      futex_wake (&cv->seq, 1);
+    }
+}
+
+/* Wakes every thread waiting on CV.  M must be held. */
+void
+condvar_broadcast (struct condvar *cv, struct mutex *m UNUSED)
+{
+  if (cv->waiters > 0)
+    {
+      atomic_fetch_add (&cv->seq, 1);
+      futex_wake (&cv->seq, INT_MAX);
+    }
+}
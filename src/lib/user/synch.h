@@ -0,0 +1,33 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* User-level mutex.  Locking and unlocking an uncontended mutex
+   make no system calls; contended ones sleep with futex_wait(). */
+struct mutex
+  {
+    int state;                  /* 0: unlocked, 1: locked,
+                                   2: locked, may have waiters. */
+  };
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* User-level condition variable, used with a struct mutex.
+   Signaling a condition variable that no thread waits on makes
+   no system call. */
+struct condvar
+  {
+    int seq;                    /* Bumped by every signal. */
+    int waiters;                /* Threads in condvar_wait(). */
+  };
+
+void condvar_init (struct condvar *);
+void condvar_wait (struct condvar *, struct mutex *);
+void condvar_signal (struct condvar *, struct mutex *);
+void condvar_broadcast (struct condvar *, struct mutex *);
+
+#endif /* lib/user/synch.h */
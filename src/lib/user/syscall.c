@@ -182,3 +182,91 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+schedstat (pid_t pid, struct sched_stats *stats)
+{
+  return syscall2 (SYS_SCHEDSTAT, pid, stats);
+}
+
+bool
+futex_wait (int *addr, int val)
+{
+  return syscall2 (SYS_FUTEX_WAIT, addr, val);
+}
+
+int
+futex_wake (int *addr, int cnt)
+{
+  return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
+bool
+set_deadline (int period_ms, int budget_ms)
+{
+  return syscall2 (SYS_SET_DEADLINE, period_ms, budget_ms);
+}
+
+bool
+set_tickets (int tickets)
+{
+  return syscall1 (SYS_SET_TICKETS, tickets);
+}
+
+int
+clock_gettime (clockid_t clock, struct timespec *ts)
+{
+  return syscall2 (SYS_CLOCK_GETTIME, clock, ts);
+}
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+/* New threads begin here, on an empty stack, with the function to
+   run in %eax and its argument in %edx. */
+void _thread_entry (void);
+void _thread_start (thread_func *, void *aux) NO_RETURN;
+asm (".text\n"
+     "_thread_entry:\n"
+     "\tpushl %edx\n"
+     "\tpushl %eax\n"
+     "\tcall _thread_start\n");
+
+/* Runs FUNC (AUX) in a new thread, then ends the thread. */
+void
+_thread_start (thread_func *func, void *aux)
+{
+  func (aux);
+  thread_exit ();
+}
+
+/* Issues the thread creation system call.  The kernel reads the
+   arguments from this function's own frame, so it must not be
+   inlined into thread_create(). */
+tid_t NO_INLINE
+_thread_create (void (*entry) (void), thread_func *func, void *aux)
+{
+  return syscall3 (SYS_THREAD_CREATE, entry, func, aux);
+}
+
+tid_t
+thread_create (thread_func *func, void *aux)
+{
+  return _thread_create (_thread_entry, func, aux);
+}
+
+bool
+thread_join (tid_t tid)
+{
+  return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+void
+thread_exit (void)
+{
+  syscall0 (SYS_THREAD_EXIT);
+  NOT_REACHED ();
+}
@@ -3,11 +3,17 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <clock.h>
+#include <sched-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
 /* Map region identifier. */
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
@@ -45,4 +51,22 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+bool schedstat (pid_t, struct sched_stats *);
+bool futex_wait (int *addr, int val);
+int futex_wake (int *addr, int cnt);
+bool set_deadline (int period_ms, int budget_ms);
+bool set_tickets (int tickets);
+int clock_gettime (clockid_t, struct timespec *);
+pid_t fork (void);
+
+/* Threads within a process.  They share the address space and
+   open files; the process ends when its last thread does, or when
+   any thread calls exit(), which ends all of them. */
+typedef void thread_func (void *aux);
+tid_t thread_create (thread_func *, void *aux);
+bool thread_join (tid_t);
+void thread_exit (void) NO_RETURN;
+tid_t _thread_create (void (*entry) (void), thread_func *, void *aux);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,57 @@
+/* Reader process for the rw-bench tests.  Reads the shared data
+   file over and over, checking its contents each time, until the
+   writer has finished.  Reads are sector-sized so that the time
+   goes to the file system rather than to system call overhead.
+
+   The readers together keep the file system lock busy for
+   reading, so a lock that let new readers overtake a waiting
+   writer could keep the writer from ever finishing.  Fails if
+   the writer has not finished after READ_MAX reads. */
+
+#include <random.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/rw-bench.h"
+
+const char *test_name = "child-rw-read";
+
+static char expected[BUF_SIZE];
+static char buf[BUF_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  int child_idx;
+  int i;
+
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  random_init (0);
+  random_bytes (expected, sizeof expected);
+
+  for (i = 0; ; i++) 
+    {
+      size_t ofs;
+      int fd;
+
+      if ((fd = open (done_name)) > 1)
+        {
+          close (fd);
+          break;
+        }
+      if (i >= READ_MAX)
+        fail ("writer starved: not done after %d reads", i);
+
+      CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+      for (ofs = 0; ofs < sizeof buf; ofs += 512)
+        CHECK (read (fd, buf + ofs, 512) == 512, "read \"%s\"", file_name);
+      compare_bytes (buf, expected, sizeof buf, 0, file_name);
+      close (fd);
+    }
+
+  return child_idx;
+}
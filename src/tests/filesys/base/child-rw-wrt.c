@@ -0,0 +1,38 @@
+/* Writer process for the rw-bench tests.  Repeatedly creates,
+   fills and removes its own file, taking the file system lock
+   for writing while the readers run, then creates the file that
+   tells the readers to stop. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/rw-bench.h"
+
+const char *test_name = "child-rw-wrt";
+
+static char buf[BUF_SIZE];
+
+int
+main (void) 
+{
+  int i;
+
+  quiet = true;
+  memset (buf, 'w', sizeof buf);
+
+  for (i = 0; i < WRITE_CNT; i++) 
+    {
+      int fd;
+
+      CHECK (create (scratch_name, sizeof buf),
+             "create \"%s\"", scratch_name);
+      CHECK ((fd = open (scratch_name)) > 1, "open \"%s\"", scratch_name);
+      CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+             "write \"%s\"", scratch_name);
+      close (fd);
+      CHECK (remove (scratch_name), "remove \"%s\"", scratch_name);
+    }
+  CHECK (create (done_name, 0), "create \"%s\"", done_name);
+
+  return 0;
+}
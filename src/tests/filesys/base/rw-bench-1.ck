@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rw-bench) begin
+(rw-bench) create "data"
+(rw-bench) open "data"
+(rw-bench) write "data"
+(rw-bench) close "data"
+(rw-bench) exec writer
+(rw-bench) exec child 1 of 1: "child-rw-read 0"
+(rw-bench) wait for child 1 of 1 returned 0 (expected 0)
+(rw-bench) wait for writer
+(rw-bench) end
+EOF
+pass;
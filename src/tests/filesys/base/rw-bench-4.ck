@@ -0,0 +1,31 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rw-bench) begin
+(rw-bench) create "data"
+(rw-bench) open "data"
+(rw-bench) write "data"
+(rw-bench) close "data"
+(rw-bench) exec writer
+(rw-bench) exec child 1 of 4: "child-rw-read 0"
+(rw-bench) exec child 2 of 4: "child-rw-read 1"
+(rw-bench) exec child 3 of 4: "child-rw-read 2"
+(rw-bench) exec child 4 of 4: "child-rw-read 3"
+(rw-bench) wait for child 1 of 4 returned 0 (expected 0)
+(rw-bench) wait for child 2 of 4 returned 1 (expected 1)
+(rw-bench) wait for child 3 of 4 returned 2 (expected 2)
+(rw-bench) wait for child 4 of 4 returned 3 (expected 3)
+(rw-bench) wait for writer
+(rw-bench) end
+EOF
+
+# With several readers, some should hold the file system lock at
+# the same time instead of taking turns.
+our ($test);
+my ($readers) = map (/^Syscall: file lock held by at most (\d+) readers at once$/,
+		     read_text_file ("$test.output"));
+fail "missing file lock statistics in output\n" if !defined $readers;
+fail "readers never held the file system lock together\n" if $readers < 2;
+pass;
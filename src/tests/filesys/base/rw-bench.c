@@ -0,0 +1,51 @@
+/* Starts one writer and the number of reader processes given by
+   the first command-line argument.  The readers all open and
+   read the same file until the writer, which repeatedly creates,
+   writes and removes a file of its own, has finished.  The
+   readers fail if the writer does not finish while they keep
+   the file system lock busy, so the test checks that a steady
+   stream of readers cannot starve a writer.  With more than one
+   reader, the .ck file also checks, from the statistics printed
+   at shutdown, that readers held the lock at the same time. */
+
+#include <random.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/rw-bench.h"
+
+#define READER_MAX 16
+
+const char *test_name = "rw-bench";
+
+static char buf[BUF_SIZE];
+
+int
+main (int argc, char *argv[]) 
+{
+  pid_t readers[READER_MAX];
+  pid_t writer;
+  size_t reader_cnt;
+  int fd;
+
+  msg ("begin");
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  reader_cnt = atoi (argv[1]);
+  CHECK (reader_cnt > 0 && reader_cnt <= READER_MAX,
+         "reader count must be between 1 and %d", READER_MAX);
+
+  CHECK (create (file_name, sizeof buf), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) > 0, "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  CHECK ((writer = exec ("child-rw-wrt")) != PID_ERROR, "exec writer");
+  exec_children ("child-rw-read", readers, reader_cnt);
+  wait_children (readers, reader_cnt);
+  CHECK (wait (writer) == 0, "wait for writer");
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef TESTS_FILESYS_BASE_RW_BENCH_H
+#define TESTS_FILESYS_BASE_RW_BENCH_H
+
+#define BUF_SIZE 4096           /* Size of the shared data file. */
+#define READ_MAX 1000           /* Most times each reader reads it. */
+#define WRITE_CNT 16            /* Times the writer rewrites its file. */
+static const char file_name[] = "data";
+static const char scratch_name[] = "scratch";
+static const char done_name[] = "done";  /* Created by the writer
+                                            when it finishes. */
+
+#endif /* tests/filesys/base/rw-bench.h */
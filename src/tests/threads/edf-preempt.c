@@ -0,0 +1,63 @@
+/* Checks that a thread in the EDF class runs ahead of a
+   CPU-bound thread of the highest priority, which would starve
+   any thread of the priority class.
+
+   The main thread joins the EDF class and starts a PRI_MAX
+   thread that spins until told to stop.  Each time the main
+   thread wakes from a sleep, it must preempt the spinner at
+   once.  Then the main thread blocks on a semaphore, and when
+   the spinner ups it, the main thread must run before sema_up()
+   returns. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func spinner;
+static struct semaphore wake;
+static volatile bool woken;
+static volatile bool done;
+
+void
+test_edf_preempt (void) 
+{
+  int i;
+
+  if (!thread_set_deadline (10, 2))
+    fail ("EDF thread with 20%% utilization not admitted");
+
+  sema_init (&wake, 0);
+  thread_create ("spinner", PRI_MAX, spinner, NULL);
+  for (i = 0; i < 5; i++)
+    {
+      timer_sleep (10);
+      msg ("EDF thread woke up, iteration %d.", i);
+    }
+  sema_down (&wake);
+  woken = true;
+  msg ("EDF thread woke up from semaphore.");
+
+  /* Back in the priority class, the spinner outranks us, so it
+     finishes before we continue. */
+  done = true;
+  thread_set_deadline (0, 0);
+  msg ("Spinner should have stopped.");
+}
+
+static void
+spinner (void *aux UNUSED) 
+{
+  /* Wait for the EDF thread to block on WAKE, then wake it. */
+  while (wait_queue_empty (&wake.waiters))
+    continue;
+  sema_up (&wake);
+  if (!woken)
+    fail ("EDF thread did not preempt at once on sema_up()");
+
+  while (!done)
+    continue;
+  msg ("Spinner stopped.");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-preempt) begin
+(edf-preempt) EDF thread woke up, iteration 0.
+(edf-preempt) EDF thread woke up, iteration 1.
+(edf-preempt) EDF thread woke up, iteration 2.
+(edf-preempt) EDF thread woke up, iteration 3.
+(edf-preempt) EDF thread woke up, iteration 4.
+(edf-preempt) EDF thread woke up from semaphore.
+(edf-preempt) Spinner stopped.
+(edf-preempt) Spinner should have stopped.
+(edf-preempt) end
+EOF
+pass;
@@ -0,0 +1,63 @@
+/* Checks that an EDF thread that overruns its budget is
+   throttled until its next period begins, so that even a
+   PRI_MIN thread gets to run, and that admission control
+   refuses to give the EDF class the whole CPU.
+
+   The main thread asks for 2 ticks in every 10 and then spins
+   for RUN_TICKS ticks.  It may run for no more than its budget
+   in each period it spans, and the low-priority thread must run
+   in the rest. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define PERIOD 10
+#define BUDGET 2
+#define RUN_TICKS 50
+
+static thread_func low_thread;
+static volatile bool done;
+static volatile long long low_spins;
+
+void
+test_edf_throttle (void) 
+{
+  struct sched_stats before, after;
+  long long run_ticks;
+  int64_t start;
+
+  if (!thread_set_deadline (PERIOD, BUDGET))
+    fail ("EDF thread with 20%% utilization not admitted");
+  if (thread_set_deadline (PERIOD, PERIOD))
+    fail ("EDF thread with 100%% utilization admitted");
+  msg ("Admission control refused 100%% utilization.");
+
+  thread_create ("low", PRI_MIN, low_thread, NULL);
+
+  thread_get_stats (thread_tid (), &before);
+  start = timer_ticks ();
+  while (timer_elapsed (start) < RUN_TICKS)
+    continue;
+  thread_get_stats (thread_tid (), &after);
+  done = true;
+  thread_set_deadline (0, 0);
+
+  run_ticks = after.run_ticks - before.run_ticks;
+  if (run_ticks > (RUN_TICKS / PERIOD + 1) * BUDGET)
+    fail ("EDF thread ran %lld ticks in %d, over its budget",
+          run_ticks, RUN_TICKS);
+  msg ("EDF thread stayed within its budget.");
+  if (low_spins == 0)
+    fail ("low-priority thread never ran");
+  msg ("Low-priority thread ran while EDF thread was throttled.");
+}
+
+static void
+low_thread (void *aux UNUSED) 
+{
+  while (!done)
+    low_spins++;
+}
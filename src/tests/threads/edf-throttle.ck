@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-throttle) begin
+(edf-throttle) Admission control refused 100% utilization.
+(edf-throttle) EDF thread stayed within its budget.
+(edf-throttle) Low-priority thread ran while EDF thread was throttled.
+(edf-throttle) end
+EOF
+pass;
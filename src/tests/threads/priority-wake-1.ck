@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "missing wakeup timing in output"
+  unless grep (/^\(priority-wake-1\) 1 waiters: 2000 wakeups in \d+ ticks\.$/,
+               @output);
+fail "missing PASS in output"
+  unless grep ($_ eq '(priority-wake-1) PASS', @output);
+
+pass;
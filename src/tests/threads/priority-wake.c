@@ -0,0 +1,127 @@
+/* Measures the cost of waking the highest-priority waiter of a
+   semaphore with 1, 16 or 256 threads waiting on it.
+
+   The waiters have priorities above the main thread's, so the
+   main thread runs only while every waiter is blocked on the
+   semaphore.  In each round the main thread ups the semaphore,
+   which must wake the highest-priority waiter; that waiter
+   reports back and blocks on the semaphore again before the main
+   thread can continue.  The rest stay blocked throughout, so the
+   elapsed time of a fixed number of rounds shows how the cost of
+   a wakeup grows with the number of waiters. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ROUND_CNT 2000
+
+static void test_priority_wake (int waiter_cnt);
+
+void
+test_priority_wake_1 (void) 
+{
+  test_priority_wake (1);
+}
+
+void
+test_priority_wake_16 (void) 
+{
+  test_priority_wake (16);
+}
+
+void
+test_priority_wake_256 (void) 
+{
+  test_priority_wake (256);
+}
+
+static struct semaphore ready;  /* Each waiter ups once at start. */
+static struct semaphore wake;   /* Waiters wait here. */
+static struct semaphore done;   /* Woken waiter reports here. */
+static bool stop;               /* Tells waiters to exit. */
+static int woken_priority;      /* Priority of last woken waiter. */
+
+static thread_func wake_thread;
+
+static void
+test_priority_wake (int waiter_cnt) 
+{
+  int64_t start_time, elapsed;
+  int max_priority = PRI_MIN;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&ready, 0);
+  sema_init (&wake, 0);
+  sema_init (&done, 0);
+  stop = false;
+
+  thread_set_priority (PRI_MIN);
+  for (i = 0; i < waiter_cnt; i++) 
+    {
+      int priority = PRI_MIN + 1 + i % (PRI_DEFAULT - PRI_MIN - 1);
+      char name[16];
+
+      snprintf (name, sizeof name, "wake %d", i);
+      if (thread_create (name, priority, wake_thread, NULL) == TID_ERROR)
+        fail ("could not create waiter %d", i);
+      if (priority > max_priority)
+        max_priority = priority;
+    }
+
+  /* Wait until every waiter has started.  Each ups READY just
+     before it downs WAKE, and outranks us, so it has blocked on
+     WAKE by the time we run again. */
+  for (i = 0; i < waiter_cnt; i++)
+    sema_down (&ready);
+  if (wait_queue_empty (&wake.waiters)
+      || wait_queue_front (&wake.waiters)->thread->priority != max_priority)
+    fail ("highest-priority waiter is not blocked");
+
+  start_time = timer_ticks ();
+  for (i = 0; i < ROUND_CNT; i++) 
+    {
+      sema_up (&wake);
+      sema_down (&done);
+      if (woken_priority != max_priority)
+        fail ("woke waiter of priority %d, expected %d",
+              woken_priority, max_priority);
+    }
+  elapsed = timer_elapsed (start_time);
+
+  stop = true;
+  for (i = 0; i < waiter_cnt; i++) 
+    {
+      sema_up (&wake);
+      sema_down (&done);
+    }
+
+  thread_set_priority (PRI_DEFAULT);
+
+  msg ("%d waiters: %d wakeups in %"PRId64" ticks.",
+       waiter_cnt, ROUND_CNT, elapsed);
+  msg ("PASS");
+}
+
+static void
+wake_thread (void *aux UNUSED) 
+{
+  sema_up (&ready);
+  for (;;) 
+    {
+      sema_down (&wake);
+      woken_priority = thread_get_priority ();
+      if (stop)
+        break;
+      sema_up (&done);
+    }
+  sema_up (&done);
+}
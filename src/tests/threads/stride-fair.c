@@ -0,0 +1,111 @@
+/* Checks that the stride scheduler shares the CPU in proportion
+   to tickets.
+
+   The "stride-fair" tests run 2, 20 or 60 CPU-bound threads, with
+   thread I holding (I % 3 + 1) * 100 tickets.  Each thread counts
+   the timer ticks during which it ran, and each thread's share of
+   all the ticks counted must be within 5% of its share of the
+   tickets (see stride.pm).  The threads spin for at least 30
+   seconds, and longer when there are many of them, so that even
+   a thread with 100 tickets expects about 100 ticks. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void test_stride_fair (int thread_cnt);
+
+void
+test_stride_fair_2 (void) 
+{
+  test_stride_fair (2);
+}
+
+void
+test_stride_fair_20 (void) 
+{
+  test_stride_fair (20);
+}
+
+void
+test_stride_fair_60 (void) 
+{
+  test_stride_fair (60);
+}
+
+#define MAX_THREAD_CNT 60
+
+struct thread_info 
+  {
+    int64_t start_time;
+    int64_t spin_time;
+    int tick_count;
+    int tickets;
+  };
+
+static void load_thread (void *aux);
+
+static void
+test_stride_fair (int thread_cnt)
+{
+  struct thread_info info[MAX_THREAD_CNT];
+  int64_t start_time, spin_time;
+  int ticket_sum;
+  int i;
+
+  ASSERT (thread_stride);
+  ASSERT (thread_cnt <= MAX_THREAD_CNT);
+
+  ticket_sum = 0;
+  for (i = 0; i < thread_cnt; i++)
+    ticket_sum += (i % 3 + 1) * 100;
+  spin_time = 30 * TIMER_FREQ;
+  if (spin_time < ticket_sum)
+    spin_time = ticket_sum;
+
+  start_time = timer_ticks ();
+  msg ("Starting %d threads...", thread_cnt);
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      struct thread_info *ti = &info[i];
+      char name[16];
+
+      ti->start_time = start_time;
+      ti->spin_time = spin_time;
+      ti->tick_count = 0;
+      ti->tickets = (i % 3 + 1) * 100;
+
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, load_thread, ti);
+    }
+  msg ("Starting threads took %"PRId64" ticks.", timer_elapsed (start_time));
+
+  msg ("Sleeping to let threads run, please wait...");
+  timer_sleep (5 * TIMER_FREQ + spin_time + 10 * TIMER_FREQ
+               - timer_elapsed (start_time));
+
+  for (i = 0; i < thread_cnt; i++)
+    msg ("Thread %d received %d ticks.", i, info[i].tick_count);
+}
+
+static void
+load_thread (void *ti_) 
+{
+  struct thread_info *ti = ti_;
+  int64_t sleep_time = 5 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + ti->spin_time;
+  int64_t last_time = 0;
+
+  thread_set_tickets (ti->tickets);
+  timer_sleep (sleep_time - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
@@ -0,0 +1,49 @@
+# -*- perl -*-
+use strict;
+use warnings;
+
+# Tickets held by thread I in the stride-fair tests.
+sub stride_tickets {
+    my ($i) = @_;
+    return ($i % 3 + 1) * 100;
+}
+
+sub check_stride_fair {
+    my ($thread_cnt) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    my (@actual);
+    local ($_);
+    foreach (@output) {
+	my ($id, $count) = /Thread (\d+) received (\d+) ticks\./ or next;
+	$actual[$id] = $count;
+    }
+
+    my ($total_ticks) = 0;
+    my ($total_tickets) = 0;
+    for my $i (0...$thread_cnt - 1) {
+	fail "Thread $i did not report its tick count.\n"
+	  if !defined $actual[$i];
+	$total_ticks += $actual[$i];
+	$total_tickets += stride_tickets ($i);
+    }
+
+    my ($ok) = 1;
+    for my $i (0...$thread_cnt - 1) {
+	my ($expected) = $total_ticks * stride_tickets ($i) / $total_tickets;
+	if (abs ($actual[$i] - $expected) > .05 * $expected + .01) {
+	    printf "Thread %d with %d tickets received %d ticks, "
+	      . "expected %.1f +/- 5%%.\n",
+	      $i, stride_tickets ($i), $actual[$i], $expected;
+	    $ok = 0;
+	}
+    }
+    fail "Some threads' CPU shares differed from their ticket shares "
+      . "by more than 5%.\n" if !$ok;
+    pass;
+}
+
+1;
@@ -29,6 +29,9 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-wake-1", test_priority_wake_1},
+    {"priority-wake-16", test_priority_wake_16},
+    {"priority-wake-256", test_priority_wake_256},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +41,11 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"edf-preempt", test_edf_preempt},
+    {"edf-throttle", test_edf_throttle},
+    {"stride-fair-2", test_stride_fair_2},
+    {"stride-fair-20", test_stride_fair_20},
+    {"stride-fair-60", test_stride_fair_60},
   };
 
 static const char *test_name;
@@ -23,6 +23,9 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_priority_wake_1;
+extern test_func test_priority_wake_16;
+extern test_func test_priority_wake_256;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -32,6 +35,11 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_edf_preempt;
+extern test_func test_edf_throttle;
+extern test_func test_stride_fair_2;
+extern test_func test_stride_fair_20;
+extern test_func test_stride_fair_60;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,51 @@
+/* Reads the monotonic and real-time clocks, checks that the
+   monotonic clock does not run backward and that it resolves
+   intervals shorter than a timer tick, and that an invalid clock
+   is rejected. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Length of a 100 Hz timer tick, in nanoseconds. */
+#define TICK_NS 10000000
+
+static int64_t
+to_ns (const struct timespec *ts) 
+{
+  return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+void
+test_main (void) 
+{
+  struct timespec a, b;
+  int64_t min_delta = -1;
+  int i;
+
+  CHECK (clock_gettime (CLOCK_REALTIME, &a) == 0,
+         "clock_gettime(CLOCK_REALTIME)");
+  if (a.tv_sec <= 0 || a.tv_nsec < 0 || a.tv_nsec >= 1000000000)
+    fail ("bad real time %lld s, %ld ns", a.tv_sec, (long) a.tv_nsec);
+
+  CHECK (clock_gettime (CLOCK_MONOTONIC, &a) == 0,
+         "clock_gettime(CLOCK_MONOTONIC)");
+  for (i = 0; i < 1000; i++)
+    {
+      int64_t delta;
+
+      if (clock_gettime (CLOCK_MONOTONIC, &b) != 0)
+        fail ("clock_gettime(CLOCK_MONOTONIC) failed");
+      delta = to_ns (&b) - to_ns (&a);
+      if (delta < 0)
+        fail ("monotonic clock ran backward by %lld ns", -delta);
+      if (delta > 0 && (min_delta < 0 || delta < min_delta))
+        min_delta = delta;
+      a = b;
+    }
+  if (min_delta < 0 || min_delta >= TICK_NS)
+    fail ("monotonic clock has no sub-tick resolution");
+  msg ("monotonic clock has sub-tick resolution");
+
+  CHECK (clock_gettime (12345, &a) == -1, "clock_gettime(12345) must fail");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock-gettime) begin
+(clock-gettime) clock_gettime(CLOCK_REALTIME)
+(clock-gettime) clock_gettime(CLOCK_MONOTONIC)
+(clock-gettime) monotonic clock has sub-tick resolution
+(clock-gettime) clock_gettime(12345) must fail
+(clock-gettime) end
+clock-gettime: exit(0)
+EOF
+pass;
@@ -0,0 +1,54 @@
+/* Builds a chain of processes, each waiting for the next, to the
+   depth given by the first command-line argument.  The last one
+   then execs and waits for child-simple CHILD_CNT times.  Every
+   exec, wait and exit looks up threads by tid while the whole
+   chain is alive.  The .ck files check that the "tid comparisons"
+   per "tid lookups" reported at shutdown stay bounded, so that
+   lookup cost does not grow with the number of live processes. */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define CHILD_CNT 8
+
+const char *test_name = "exec-fanout";
+
+int
+main (int argc, char *argv[]) 
+{
+  /* The top of the chain is started with just the depth; the
+     others also get a marker so that only the top prints. */
+  bool top = argc == 2;
+  int n = atoi (argv[1]);
+  int i;
+
+  if (top)
+    msg ("begin");
+  if (n != 0) 
+    {
+      char child_cmd[128];
+      pid_t child_pid;
+      int code;
+
+      snprintf (child_cmd, sizeof child_cmd, "%s %d x", argv[0], n - 1);
+      child_pid = exec (child_cmd);
+      if (child_pid == -1)
+        fail ("exec(\"%s\") failed", child_cmd);
+      code = wait (child_pid);
+      if (code != n - 1)
+        fail ("wait(exec(\"%s\")) returned %d", child_cmd, code);
+    }
+  else
+    for (i = 0; i < CHILD_CNT; i++)
+      {
+        int code = wait (exec ("child-simple"));
+        if (code != 81)
+          fail ("wait(exec(\"child-simple\")) returned %d", code);
+      }
+  if (top)
+    msg ("end");
+  return n;
+}
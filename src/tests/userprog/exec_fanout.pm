@@ -0,0 +1,42 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# Each tid lookup should cost a bounded number of comparisons,
+# however many processes are alive, as the tid index is a hash
+# table that keeps at most a few threads per bucket.  A linear
+# search of all threads would need about half the live threads
+# per lookup, far more than this with a 32-deep chain.
+our ($MAX_COMPARES_PER_LOOKUP) = 8;
+
+sub check_exec_fanout {
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(exec-fanout) begin
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(exec-fanout) end
+EOF
+
+    my ($stats) = grep (/^Thread: \d+ tid lookups, \d+ tid comparisons$/,
+			@output);
+    fail "missing tid lookup statistics in output\n" if !defined $stats;
+    my ($lookups, $compares)
+      = $stats =~ /^Thread: (\d+) tid lookups, (\d+) tid comparisons$/;
+    fail "no tid lookups were made\n" if $lookups == 0;
+    fail sprintf ("%.1f tid comparisons per lookup, expected at most %d\n",
+		  $compares / $lookups, $MAX_COMPARES_PER_LOOKUP)
+      if $compares > $lookups * $MAX_COMPARES_PER_LOOKUP;
+    pass;
+}
+
+1;
@@ -0,0 +1,31 @@
+/* Exercises futex_wait() and futex_wake() directly, then the
+   uncontended paths of the user-level mutex and condition
+   variable built on them. */
+
+#include <syscall.h>
+#include <synch.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int word = 5;
+
+void
+test_main (void) 
+{
+  struct mutex m;
+  struct condvar cv;
+
+  CHECK (!futex_wait (&word, 6), "futex_wait() on mismatched value");
+  CHECK (futex_wake (&word, 1) == 0, "futex_wake() with no waiters");
+
+  mutex_init (&m);
+  mutex_lock (&m);
+  CHECK (!mutex_trylock (&m), "mutex_trylock() on held mutex");
+  mutex_unlock (&m);
+  CHECK (mutex_trylock (&m), "mutex_trylock() on free mutex");
+
+  condvar_init (&cv);
+  condvar_signal (&cv, &m);
+  condvar_broadcast (&cv, &m);
+  mutex_unlock (&m);
+}
@@ -0,0 +1,22 @@
+/* Reads this process's scheduler statistics after blocking in
+   wait(), and checks that a bogus pid is rejected. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct sched_stats s;
+
+  CHECK (wait (exec ("child-simple")) == 81, "wait(exec())");
+  CHECK (schedstat (-1, &s), "schedstat(-1)");
+  if (s.sched_cnt < 1)
+    fail ("sched_cnt is %lld, expected at least 1", s.sched_cnt);
+  if (s.voluntary_cnt < 1)
+    fail ("voluntary_cnt is %lld, expected at least 1", s.voluntary_cnt);
+  if (s.run_ticks < 0 || s.ready_ticks < 0 || s.blocked_ticks < 0)
+    fail ("negative tick count");
+  CHECK (!schedstat (12345, &s), "schedstat(12345) must fail");
+}
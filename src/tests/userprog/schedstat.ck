@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(schedstat) begin
+(schedstat) wait(exec())
+(child-simple) run
+child-simple: exit(81)
+(schedstat) schedstat(-1)
+(schedstat) schedstat(12345) must fail
+(schedstat) end
+schedstat: exit(0)
+EOF
+pass;
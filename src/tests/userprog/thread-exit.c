@@ -0,0 +1,52 @@
+/* Checks that exit() in one thread ends the whole process.  The
+   main thread waits in thread_join() for a thread that waits on a
+   futex that is never woken, while another thread spins in user
+   mode; a third thread then calls exit().  None of the others
+   would ever finish on its own, so the process ends only if exit()
+   kills them all. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int never;               /* Futex word that nobody changes. */
+static volatile bool joining;   /* Set just before main joins. */
+
+static void
+wait_forever (void *aux UNUSED)
+{
+  for (;;)
+    futex_wait (&never, 0);
+}
+
+static void
+spin_forever (void *aux UNUSED)
+{
+  for (;;)
+    continue;
+}
+
+static void
+exit_process (void *aux UNUSED)
+{
+  while (!joining)
+    continue;
+  msg ("exit");
+  exit (57);
+}
+
+void
+test_main (void) 
+{
+  tid_t waiter;
+
+  CHECK ((waiter = thread_create (wait_forever, NULL)) != TID_ERROR,
+         "thread_create waiter");
+  CHECK (thread_create (spin_forever, NULL) != TID_ERROR,
+         "thread_create spinner");
+  CHECK (thread_create (exit_process, NULL) != TID_ERROR,
+         "thread_create exiter");
+  joining = true;
+  thread_join (waiter);
+  fail ("thread_join returned");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-exit) begin
+(thread-exit) thread_create waiter
+(thread-exit) thread_create spinner
+(thread-exit) thread_create exiter
+(thread-exit) exit
+thread-exit: exit(57)
+EOF
+pass;
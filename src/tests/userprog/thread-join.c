@@ -0,0 +1,65 @@
+/* Starts threads that sum parts of a shared array, joins them,
+   and checks their results.  Also checks that the threads share
+   the process's file descriptors and that a thread cannot be
+   joined twice. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ELEM_CNT 4096
+
+static int array[ELEM_CNT];
+static int sums[THREAD_CNT];
+static int handle;
+static int handle_size;
+
+static void
+sum_part (void *aux)
+{
+  int i = (int) aux;
+  int j;
+
+  for (j = i * (ELEM_CNT / THREAD_CNT); j < (i + 1) * (ELEM_CNT / THREAD_CNT);
+       j++)
+    sums[i] += array[j];
+}
+
+static void
+get_size (void *aux UNUSED)
+{
+  handle_size = filesize (handle);
+}
+
+void
+test_main (void) 
+{
+  tid_t tids[THREAD_CNT];
+  tid_t tid;
+  int i, total;
+
+  for (i = 0; i < ELEM_CNT; i++)
+    array[i] = i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = thread_create (sum_part, (void *) i)) != TID_ERROR,
+           "thread_create %d", i);
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (thread_join (tids[i]), "thread_join %d", i);
+
+  total = 0;
+  for (i = 0; i < THREAD_CNT; i++)
+    total += sums[i];
+  if (total != ELEM_CNT * (ELEM_CNT - 1) / 2)
+    fail ("sum is %d, expected %d", total, ELEM_CNT * (ELEM_CNT - 1) / 2);
+
+  CHECK (!thread_join (tids[0]), "second thread_join must fail");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((tid = thread_create (get_size, NULL)) != TID_ERROR,
+         "thread_create");
+  CHECK (thread_join (tid), "thread_join");
+  if (handle_size != filesize (handle))
+    fail ("thread saw size %d, expected %d", handle_size, filesize (handle));
+}
@@ -0,0 +1,62 @@
+/* Has several threads increment a shared counter under a user
+   mutex, waiting on a condition variable for their turn to
+   start, and checks that no increment is lost. */
+
+#include <syscall.h>
+#include <synch.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITER_CNT 2000
+
+static struct mutex mutex;
+static struct condvar go_cv;
+static bool go;
+static int counter;
+
+static void
+increment (void *aux UNUSED)
+{
+  int i;
+
+  mutex_lock (&mutex);
+  while (!go)
+    condvar_wait (&go_cv, &mutex);
+  mutex_unlock (&mutex);
+
+  for (i = 0; i < ITER_CNT; i++)
+    {
+      mutex_lock (&mutex);
+      counter++;
+      mutex_unlock (&mutex);
+    }
+}
+
+void
+test_main (void) 
+{
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  mutex_init (&mutex);
+  condvar_init (&go_cv);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      tids[i] = thread_create (increment, NULL);
+      if (tids[i] == TID_ERROR)
+        fail ("thread_create %d failed", i);
+    }
+
+  mutex_lock (&mutex);
+  go = true;
+  condvar_broadcast (&go_cv, &mutex);
+  mutex_unlock (&mutex);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    if (!thread_join (tids[i]))
+      fail ("thread_join %d failed", i);
+  if (counter != THREAD_CNT * ITER_CNT)
+    fail ("counter is %d, expected %d", counter, THREAD_CNT * ITER_CNT);
+  msg ("counter is %d", counter);
+}
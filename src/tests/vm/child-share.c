@@ -0,0 +1,29 @@
+/* Child process of page-share.
+   Checks that 256 kB of read-only data, which every instance of
+   this program may share, holds what the executable says. */
+
+#include "tests/lib.h"
+
+const char *test_name = "child-share";
+
+#define S16 "0123456789abcdef"
+#define S256 S16 S16 S16 S16 S16 S16 S16 S16 \
+             S16 S16 S16 S16 S16 S16 S16 S16
+#define S4K S256 S256 S256 S256 S256 S256 S256 S256 \
+            S256 S256 S256 S256 S256 S256 S256 S256
+#define S64K S4K S4K S4K S4K S4K S4K S4K S4K \
+             S4K S4K S4K S4K S4K S4K S4K S4K
+
+static const char table[] = S64K S64K S64K S64K;
+
+int
+main (void)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof table - 1; i++)
+    if (table[i] != S16[i % 16])
+      fail ("byte %zu of table is %d", i, table[i]);
+
+  return 0x42;
+}
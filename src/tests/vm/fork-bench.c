@@ -0,0 +1,69 @@
+/* Compares the cost of creating a process with fork() to that of
+   creating it with exec(), for a process that exits at once.
+
+   Run with no arguments, this program creates ITERATIONS children
+   each way and reports the time per child.  exec() loads this
+   program again, with an argument that makes it exit.  fork()
+   only shares the parent's pages copy-on-write, so it should
+   come out well ahead; the test fails unless it is at least
+   MIN_SPEEDUP times as fast, which leaves room for timing noise
+   under the emulator. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "fork-bench";
+
+#define ITERATIONS 50
+#define MIN_SPEEDUP 2
+
+static int64_t
+now_ns (void) 
+{
+  struct timespec ts;
+
+  if (clock_gettime (CLOCK_MONOTONIC, &ts) != 0)
+    fail ("clock_gettime failed");
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int
+main (int argc, char *argv[] UNUSED) 
+{
+  int64_t start, fork_us, exec_us;
+  int i;
+
+  if (argc > 1)
+    return 0;
+
+  msg ("begin");
+
+  start = now_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      pid_t child = fork ();
+      if (child == 0)
+        exit (0);
+      if (child == -1 || wait (child) != 0)
+        fail ("fork failed");
+    }
+  fork_us = (now_ns () - start) / ITERATIONS / 1000;
+  msg ("fork: %lld us per process", fork_us);
+
+  start = now_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      pid_t child = exec ("fork-bench child");
+      if (child == -1 || wait (child) != 0)
+        fail ("exec failed");
+    }
+  exec_us = (now_ns () - start) / ITERATIONS / 1000;
+  msg ("exec: %lld us per process", exec_us);
+
+  if (fork_us * MIN_SPEEDUP > exec_us)
+    fail ("fork is not %d times as fast as exec", MIN_SPEEDUP);
+
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+foreach my $how ('fork', 'exec') {
+    fail "missing $how timing in output"
+      unless grep (/^\(fork-bench\) $how: \d+ us per process$/, @output);
+}
+fail "missing end in output"
+  unless grep ($_ eq '(fork-bench) end', @output);
+
+pass;
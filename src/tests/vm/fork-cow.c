@@ -0,0 +1,63 @@
+/* Forks a child that checks that it sees the parent's data, bss
+   and stack as they were at the fork, then changes them.  The
+   parent changes them too, right after the fork, and checks that
+   the child's changes do not show through. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BSS_CNT (4 * 4096 / sizeof (int))
+
+static char data[] = "data at fork";
+static int bss[BSS_CNT];
+
+/* Returns true if DATA, BSS and STACK hold the values derived
+   from SEED that fill() stores. */
+static bool
+matches (const char *stack, int seed) 
+{
+  size_t i;
+
+  if (data[0] != 'a' + seed || stack[0] != 'A' + seed)
+    return false;
+  for (i = 0; i < BSS_CNT; i++)
+    if (bss[i] != (int) i * seed)
+      return false;
+  return true;
+}
+
+static void
+fill (char *stack, int seed) 
+{
+  size_t i;
+
+  data[0] = 'a' + seed;
+  stack[0] = 'A' + seed;
+  for (i = 0; i < BSS_CNT; i++)
+    bss[i] = i * seed;
+}
+
+void
+test_main (void)
+{
+  char stack[128];
+  pid_t pid;
+
+  fill (stack, 1);
+  pid = fork ();
+  if (pid == 0)
+    {
+      /* The child reports through its exit code, since its output
+         would interleave with the parent's. */
+      if (!matches (stack, 1))
+        exit (1);
+      fill (stack, 3);
+      exit (matches (stack, 3) ? 0x42 : 2);
+    }
+  CHECK (pid > 0, "fork");
+  fill (stack, 2);
+  CHECK (wait (pid) == 0x42, "wait for child");
+  CHECK (matches (stack, 2), "parent's memory intact");
+}
@@ -0,0 +1,37 @@
+/* Changes a page of a memory-mapped file, then forks.  The child
+   must see the change through its copy of the mapping. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  static const char change[] = "changed before fork";
+  char *actual = (char *) 0x10000000;
+  int handle;
+  mapid_t map;
+  pid_t pid;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, actual)) != MAP_FAILED, "mmap \"sample.txt\"");
+  memcpy (actual, change, sizeof change - 1);
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      if (memcmp (actual, change, sizeof change - 1)
+          || memcmp (actual + sizeof change - 1, sample + sizeof change - 1,
+                     strlen (sample) - (sizeof change - 1)))
+        exit (1);
+      exit (0x42);
+    }
+  CHECK (pid > 0, "fork");
+  CHECK (wait (pid) == 0x42, "wait for child");
+
+  munmap (map);
+  close (handle);
+}
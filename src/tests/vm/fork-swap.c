@@ -0,0 +1,59 @@
+/* Forks a child with 2 MB of private memory, more than the user
+   pool holds, so that pages shared copy-on-write are swapped out
+   and back in while parent and child each rewrite half of them. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+#define PAGE_SIZE 4096
+
+static char buf[SIZE];
+
+/* Returns true if page PAGE of buf is filled with byte VALUE. */
+static bool
+page_is (size_t page, char value) 
+{
+  size_t i;
+
+  for (i = page * PAGE_SIZE; i < (page + 1) * PAGE_SIZE; i++)
+    if (buf[i] != value)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  size_t page;
+  pid_t pid;
+
+  for (page = 0; page < SIZE / PAGE_SIZE; page++)
+    memset (buf + page * PAGE_SIZE, page, PAGE_SIZE);
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      /* The child rewrites the even pages. */
+      for (page = 0; page < SIZE / PAGE_SIZE; page++)
+        if (!page_is (page, page))
+          exit (1);
+      for (page = 0; page < SIZE / PAGE_SIZE; page += 2)
+        memset (buf + page * PAGE_SIZE, ~page, PAGE_SIZE);
+      for (page = 0; page < SIZE / PAGE_SIZE; page++)
+        if (!page_is (page, page % 2 ? page : ~page))
+          exit (2);
+      exit (0x42);
+    }
+  CHECK (pid > 0, "fork");
+
+  /* The parent rewrites the odd pages. */
+  for (page = 1; page < SIZE / PAGE_SIZE; page += 2)
+    memset (buf + page * PAGE_SIZE, ~page, PAGE_SIZE);
+  CHECK (wait (pid) == 0x42, "wait for child");
+  for (page = 0; page < SIZE / PAGE_SIZE; page++)
+    if (!page_is (page, page % 2 ? ~page : page))
+      fail ("page %zu of parent is corrupted", page);
+}
@@ -0,0 +1,100 @@
+/* Measures the cost of faulting in and freeing user pages as the
+   number of resident frames grows.
+
+   Run with no arguments, this program executes itself with a
+   page count as the argument, for a few page counts.  A child
+   grows its stack by that many pages, one fault each, times just
+   that loop, reports the time per page and returns it as its
+   exit status, then exits, freeing the pages.  With
+   constant-time frame table operations, the cost per page stays
+   roughly flat as the page count grows, so the parent fails if
+   it grows by more than MAX_GROWTH times from the smallest page
+   count to the largest. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "frame-scale";
+
+#define PAGE_SIZE 4096
+
+/* Page counts to measure.  The largest stays within the 8 MB
+   stack limit. */
+static const int page_cnts[] = {128, 512, 1024, 1920};
+#define PAGE_CNT_CNT (sizeof page_cnts / sizeof *page_cnts)
+
+/* Largest allowed ratio of the cost per page at the largest page
+   count to the cost per page at the smallest. */
+#define MAX_GROWTH 4
+
+static int64_t
+now_ns (void) 
+{
+  struct timespec ts;
+
+  if (clock_gettime (CLOCK_MONOTONIC, &ts) != 0)
+    fail ("clock_gettime failed");
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Writes one byte of each of the PAGE_CNT pages at PAGES, from
+   the top down. */
+static void
+write_pages (volatile char *pages, int page_cnt) 
+{
+  int i;
+
+  for (i = page_cnt - 1; i >= 0; i--)
+    pages[i * PAGE_SIZE] = i;
+}
+
+/* Faults in PAGE_CNT stack pages and returns the time taken per
+   page, in nanoseconds. */
+static int
+touch_pages (int page_cnt) 
+{
+  char pages[page_cnt * PAGE_SIZE];
+  int64_t start = now_ns ();
+
+  write_pages (pages, page_cnt);
+  return (now_ns () - start) / page_cnt;
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  int ns_per_page[PAGE_CNT_CNT];
+  size_t i;
+
+  if (argc > 1)
+    {
+      int page_cnt = atoi (argv[1]);
+      int ns = touch_pages (page_cnt);
+
+      msg ("%d pages: %d ns per page", page_cnt, ns);
+      return ns;
+    }
+
+  msg ("begin");
+  for (i = 0; i < PAGE_CNT_CNT; i++)
+    {
+      char cmd[32];
+      pid_t child;
+
+      snprintf (cmd, sizeof cmd, "frame-scale %d", page_cnts[i]);
+      child = exec (cmd);
+      if (child == -1)
+        fail ("exec \"%s\" failed", cmd);
+      ns_per_page[i] = wait (child);
+      if (ns_per_page[i] < 0)
+        fail ("%s failed", cmd);
+    }
+  if (ns_per_page[PAGE_CNT_CNT - 1] > MAX_GROWTH * (ns_per_page[0] + 1))
+    fail ("cost per page grew from %d ns at %d pages to %d ns at %d pages",
+          ns_per_page[0], page_cnts[0],
+          ns_per_page[PAGE_CNT_CNT - 1], page_cnts[PAGE_CNT_CNT - 1]);
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+foreach my $pages (128, 512, 1024, 1920) {
+    fail "missing timing for $pages pages in output"
+      unless grep (/^\(frame-scale\) $pages pages: \d+ ns per page$/,
+		   @output);
+}
+fail "missing end in output"
+  unless grep ($_ eq '(frame-scale) end', @output);
+
+pass;
@@ -0,0 +1,65 @@
+/* Maps a 32-page file and reads it sequentially, which the
+   kernel should detect and read ahead of, then maps it again and
+   reads its pages in a scrambled order, verifying the data both
+   times. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 32
+
+static char page[PAGE_SIZE];
+
+/* Returns the value of byte OFS of the file. */
+static char
+expected (size_t ofs)
+{
+  return ofs / PAGE_SIZE * 7 + ofs % 251;
+}
+
+/* Verifies page PAGE_NO of the file mapped at ACTUAL. */
+static void
+verify_page (const char *actual, size_t page_no)
+{
+  size_t ofs;
+
+  for (ofs = page_no * PAGE_SIZE; ofs < (page_no + 1) * PAGE_SIZE; ofs++)
+    if (actual[ofs] != expected (ofs))
+      fail ("byte %zu of mmap'd file is %d, expected %d",
+            ofs, actual[ofs], expected (ofs));
+}
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  mapid_t map;
+  size_t i, ofs;
+
+  CHECK (create ("data", PAGE_CNT * PAGE_SIZE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+        page[ofs] = expected (i * PAGE_SIZE + ofs);
+      if (write (handle, page, PAGE_SIZE) != PAGE_SIZE)
+        fail ("write \"data\" failed");
+    }
+
+  CHECK ((map = mmap (handle, actual)) != MAP_FAILED, "mmap \"data\"");
+  msg ("sequential pass");
+  for (i = 0; i < PAGE_CNT; i++)
+    verify_page (actual, i);
+  munmap (map);
+
+  CHECK ((map = mmap (handle, actual)) != MAP_FAILED, "mmap \"data\"");
+  msg ("scrambled pass");
+  for (i = 0; i < PAGE_CNT; i++)
+    verify_page (actual, i * 13 % PAGE_CNT);
+  munmap (map);
+
+  close (handle);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-readahead) begin
+(mmap-readahead) create "data"
+(mmap-readahead) open "data"
+(mmap-readahead) mmap "data"
+(mmap-readahead) sequential pass
+(mmap-readahead) mmap "data"
+(mmap-readahead) scrambled pass
+(mmap-readahead) end
+EOF
+pass;
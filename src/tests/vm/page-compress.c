@@ -0,0 +1,64 @@
+/* Fills 2 MB of memory, far more than the user pool, with a mix
+   of zero, same-filled, compressible, and incompressible pages,
+   so that they pass through the compressed swap cache and, with
+   its pool made small, out of it to disk.  Then verifies them
+   twice. */
+
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 512
+
+static uint8_t buf[PAGE_CNT][PAGE_SIZE];
+
+/* Returns the value of byte OFS of page PAGE. */
+static uint8_t
+expected (size_t page, size_t ofs)
+{
+  switch (page % 4)
+    {
+    case 0:
+      return 0;
+    case 1:
+      return page;
+    case 2:
+      return "compressible page "[(ofs + page) % 18];
+    default:
+      {
+        /* Linear congruential generator seeded by PAGE and OFS. */
+        uint32_t x = (page * PAGE_SIZE + ofs) * 1103515245u + 12345u;
+        x ^= x >> 16;
+        return x * 2654435761u >> 24;
+      }
+    }
+}
+
+static void
+verify (void)
+{
+  size_t page, ofs;
+
+  for (page = 0; page < PAGE_CNT; page++)
+    for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+      if (buf[page][ofs] != expected (page, ofs))
+        fail ("byte %zu of page %zu is %d, expected %d",
+              ofs, page, buf[page][ofs], expected (page, ofs));
+}
+
+void
+test_main (void)
+{
+  size_t page, ofs;
+
+  msg ("initialize");
+  for (page = 0; page < PAGE_CNT; page++)
+    for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+      buf[page][ofs] = expected (page, ofs);
+
+  msg ("read pass");
+  verify ();
+  msg ("read pass");
+  verify ();
+}
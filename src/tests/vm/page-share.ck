@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-share) begin
+(page-share) exec "child-share"
+(page-share) exec "child-share"
+(page-share) exec "child-share"
+(page-share) exec "child-share"
+(page-share) exec "child-share"
+(page-share) exec "child-share"
+(page-share) exec "child-share"
+(page-share) exec "child-share"
+(page-share) wait for child 0
+(page-share) wait for child 1
+(page-share) wait for child 2
+(page-share) wait for child 3
+(page-share) wait for child 4
+(page-share) wait for child 5
+(page-share) wait for child 6
+(page-share) wait for child 7
+(page-share) end
+EOF
+pass;
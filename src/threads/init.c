@@ -31,6 +31,9 @@
 #include "vm/frame.h"
 #include "vm/swap.h"
 #include "vm/mmfile.h"
+#include "vm/page.h"
+#include "vm/share.h"
+#include "vm/zswap.h"
 #else
 #include "tests/threads/tests.h"
 #endif
@@ -117,6 +120,7 @@ main (void)
   exception_init ();
   syscall_init ();
   frame_init ();
+  share_init ();
 #endif
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
@@ -133,7 +137,9 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
-swap_init ();
+#ifdef VM
+  swap_init ();
+#endif
 
   printf ("Boot complete.\n");
   
@@ -264,13 +270,31 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-stride"))
+        thread_stride = true;
+      else if (!strcmp (name, "-threadcache"))
+        thread_cache_prewarm = atoi (value);
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-clock"))
+        {
+          frame_clock_hands = atoi (value);
+          if (frame_clock_hands != 1 && frame_clock_hands != 2)
+            PANIC ("-clock must be 1 or 2");
+        }
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-zswap"))
+        zswap_pages = atoi (value);
+      else if (!strcmp (name, "-readahead"))
+        page_read_ahead_max = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
+  if (thread_mlfqs && thread_stride)
+    PANIC ("-mlfqs and -stride cannot be used together");
 
   /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
@@ -387,8 +411,15 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -stride            Use stride (proportional-share) scheduler.\n"
+          "  -threadcache=N     Preallocate N cached thread pages at boot.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -clock=N           Evict pages with an N-handed clock (1 or 2).\n"
+#endif
+#ifdef VM
+          "  -zswap=N           Cache swapped pages compressed in N pages (0=off).\n"
+          "  -readahead=N       Read up to N pages ahead of sequential faults.\n"
 #endif
           );
   shutdown_power_off ();
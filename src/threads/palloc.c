@@ -148,6 +148,16 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Returns the first page of the user pool and stores the number
+   of pages in the pool in *PAGE_CNT.  Every page that
+   palloc_get_page (PAL_USER) returns lies in this range. */
+void *
+palloc_user_pool (size_t *page_cnt) 
+{
+  *page_cnt = bitmap_size (user_pool.used_map);
+  return user_pool.base;
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -28,9 +28,54 @@
 
 #include "threads/synch.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Maximum length of a chain of locks through which a priority
+   is donated, e.g. H waits on a lock held by M, which waits on a
+   lock held by L, is a chain of length 2.  Bounds the time spent
+   donating with interrupts off. */
+#define DONATION_DEPTH_MAX 8
+
+/* Longest time, in timer ticks, that a thread waited for a lock
+   held by a lower-priority thread. */
+static int64_t max_inversion_ticks;
+
+static void donate_priority (struct thread *);
+static void wait_queue_wait (struct wait_queue *, struct wait_node *);
+static struct wait_node *wait_queue_wake (struct wait_queue *);
+static struct wait_node *wait_queue_next (struct wait_queue *,
+                                          struct wait_node *);
+
+#ifdef LOCK_PROFILE
+/* Lock contention profile.  Locks initialized with the same
+   name share a class, so that, for example, the child_lock of
+   every thread is reported as one line. */
+struct lock_class
+  {
+    const char *name;           /* Name given to lock_init_named(). */
+    int64_t acquires;           /* Successful acquisitions. */
+    int64_t contended;          /* Acquisitions that found it held. */
+    int64_t wait_ticks;         /* Total ticks spent waiting. */
+    int64_t wait_max;           /* Longest single wait. */
+    int64_t hold_ticks;         /* Total ticks held. */
+    int64_t hold_max;           /* Longest single hold. */
+  };
+
+/* Lock classes.  The last one collects every name that does not
+   fit. */
+#define LOCK_CLASS_MAX 64
+static struct lock_class lock_classes[LOCK_CLASS_MAX];
+static size_t lock_class_cnt;
+
+static struct lock_class *lock_class_lookup (const char *name);
+static void lock_profile_acquired (struct lock *, int64_t start,
+                                   bool contended);
+static void lock_profile_released (struct lock *);
+#endif
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -47,14 +92,7 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
-}
-
-static bool
-thread_higher_priority(struct list_elem *a, struct list_elem *b, void* aux){
-  struct thread* a_thread = list_entry(a, struct thread, elem);
-  struct thread* b_thread = list_entry(b, struct thread, elem);
-  return a_thread->priority > b_thread->priority;
+  wait_queue_init (&sema->waiters);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -75,7 +113,7 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0) 
     {
-      list_insert_ordered (&sema->waiters, &thread_current ()->elem, thread_higher_priority, NULL);
+      wait_queue_wait (&sema->waiters, &thread_current ()->waitnode);
       thread_block ();
     }
   sema->value--;
@@ -122,16 +160,17 @@ sema_up (struct semaphore *sema)
   struct thread *waking_thread = NULL;
   old_level = intr_disable ();
 
-  if (!list_empty (&sema->waiters)){
-    list_sort(&sema->waiters, thread_higher_priority, NULL);
-    waking_thread = list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem);
+  if (!wait_queue_empty (&sema->waiters)){
+    waking_thread = wait_queue_wake (&sema->waiters)->thread;
     thread_unblock(waking_thread);
   } 
   sema->value++;
-  if(waking_thread != NULL && waking_thread->priority > thread_current()->priority){
+
+  /* Let the run queue decide whether the woken thread preempts
+     us, so that an EDF thread with an earlier deadline runs at
+     once even if its priority is lower than ours. */
+  if (waking_thread != NULL)
     thread_yield_higher ();
-  }
 
   intr_set_level (old_level);
 }
@@ -187,14 +226,21 @@ sema_test_helper (void *sema_)
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
+   instead of a lock.
+
+   NAME identifies LOCK in the lock profile; lock_init() supplies
+   it automatically. */
 void
-lock_init (struct lock *lock)
+lock_init_named (struct lock *lock, const char *name UNUSED)
 {
   ASSERT (lock != NULL);
+  ASSERT (name != NULL);
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+#ifdef LOCK_PROFILE
+  lock->class = lock_class_lookup (name);
+#endif
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -208,12 +254,80 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t inversion_start = -1;
+  struct wait_node *n;
+#ifdef LOCK_PROFILE
+  int64_t start;
+  bool contended;
+#endif
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+#ifdef LOCK_PROFILE
+  start = timer_ticks ();
+  contended = lock->holder != NULL;
+#endif
+
+  /* Donate our priority to the holder, and through it to any
+     chain of holders it is itself waiting on. */
+  if (lock->holder != NULL && !thread_mlfqs)
+    {
+      if (lock->holder->priority < cur->priority)
+        inversion_start = timer_ticks ();
+      cur->waiting_lock = lock;
+      list_push_back (&lock->holder->donors, &cur->donor_elem);
+      donate_priority (cur);
+    }
+
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+
+  /* The threads still waiting on LOCK now donate to us. */
+  if (!thread_mlfqs)
+    for (n = wait_queue_front (&lock->semaphore.waiters); n != NULL;
+         n = wait_queue_next (&lock->semaphore.waiters, n))
+      {
+        struct thread *waiter = n->thread;
+        list_push_back (&cur->donors, &waiter->donor_elem);
+        if (waiter->priority > cur->priority)
+          cur->priority = waiter->priority;
+      }
+
+  if (inversion_start >= 0 && timer_elapsed (inversion_start) > max_inversion_ticks)
+    max_inversion_ticks = timer_elapsed (inversion_start);
+
+#ifdef LOCK_PROFILE
+  lock_profile_acquired (lock, start, contended);
+#endif
+  intr_set_level (old_level);
+}
+
+/* Donates T's priority to the holder of the lock T is waiting
+   on, following the chain of lock holders for at most
+   DONATION_DEPTH_MAX links.  Stops early once a holder already
+   has at least the donated priority. */
+static void
+donate_priority (struct thread *t)
+{
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (depth = 0; depth < DONATION_DEPTH_MAX && t->waiting_lock != NULL;
+       depth++)
+    {
+      struct thread *holder = t->waiting_lock->holder;
+      if (holder == NULL || holder->priority >= t->priority)
+        break;
+      thread_change_priority (holder, t->priority);
+      t = holder;
+    }
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -232,7 +346,16 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+#ifdef LOCK_PROFILE
+      {
+        enum intr_level old_level = intr_disable ();
+        lock_profile_acquired (lock, timer_ticks (), false);
+        intr_set_level (old_level);
+      }
+#endif
+    }
   return success;
 }
 
@@ -244,11 +367,43 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  struct list_elem *e;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+
+  /* Drop the donations made through LOCK and fall back to the
+     highest remaining donation, or our base priority.  This is a
+     single pass over our donors. */
+  if (!thread_mlfqs)
+    {
+      int priority = cur->base_priority;
+
+      for (e = list_begin (&cur->donors); e != list_end (&cur->donors); )
+        {
+          struct thread *donor = list_entry (e, struct thread, donor_elem);
+          if (donor->waiting_lock == lock)
+            e = list_remove (e);
+          else
+            {
+              if (donor->priority > priority)
+                priority = donor->priority;
+              e = list_next (e);
+            }
+        }
+      thread_change_priority (cur, priority);
+    }
+
+#ifdef LOCK_PROFILE
+  lock_profile_released (lock);
+#endif
   lock->holder = NULL;
   sema_up (&lock->semaphore);
+  intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -262,10 +417,136 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+/* Prints lock statistics. */
+void
+lock_print_stats (void)
+{
+  printf ("Locks: %lld ticks worst-case priority inversion\n",
+          max_inversion_ticks);
+#ifdef LOCK_PROFILE
+  lock_profile_print ();
+#endif
+}
+
+#ifdef LOCK_PROFILE
+/* Returns the lock class for NAME, creating it if necessary. */
+static struct lock_class *
+lock_class_lookup (const char *name)
+{
+  enum intr_level old_level = intr_disable ();
+  struct lock_class *c;
+  size_t i;
+
+  for (i = 0; i < lock_class_cnt; i++)
+    if (!strcmp (lock_classes[i].name, name))
+      break;
+  if (i == lock_class_cnt)
+    {
+      if (lock_class_cnt < LOCK_CLASS_MAX - 1)
+        lock_classes[lock_class_cnt++].name = name;
+      else
+        {
+          i = LOCK_CLASS_MAX - 1;
+          lock_classes[i].name = "(other)";
+        }
+    }
+  c = &lock_classes[i];
+  intr_set_level (old_level);
+
+  return c;
+}
+
+/* Records that the current thread acquired LOCK after starting
+   to wait for it at tick START.  Interrupts must be off. */
+static void
+lock_profile_acquired (struct lock *lock, int64_t start, bool contended)
+{
+  struct lock_class *c = lock->class;
+  int64_t now = timer_ticks ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  c->acquires++;
+  if (contended)
+    {
+      c->contended++;
+      c->wait_ticks += now - start;
+      if (now - start > c->wait_max)
+        c->wait_max = now - start;
+    }
+  lock->acquired_at = now;
+}
+
+/* Records that the current thread is releasing LOCK.  Interrupts
+   must be off. */
+static void
+lock_profile_released (struct lock *lock)
+{
+  struct lock_class *c = lock->class;
+  int64_t held = timer_ticks () - lock->acquired_at;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  c->hold_ticks += held;
+  if (held > c->hold_max)
+    c->hold_max = held;
+}
+
+/* Orders lock classes by decreasing total wait, then by
+   decreasing contended acquisitions. */
+static int
+lock_class_compare (const void *a_, const void *b_)
+{
+  const struct lock_class *a = *(const struct lock_class *const *) a_;
+  const struct lock_class *b = *(const struct lock_class *const *) b_;
+
+  if (a->wait_ticks != b->wait_ticks)
+    return a->wait_ticks > b->wait_ticks ? -1 : 1;
+  if (a->contended != b->contended)
+    return a->contended > b->contended ? -1 : 1;
+  return 0;
+}
+
+/* Prints the lock contention profile, most waited-for locks
+   first.  May be called at any time from outside interrupt
+   context. */
+void
+lock_profile_print (void)
+{
+  static struct lock_class snapshot[LOCK_CLASS_MAX];
+  static struct lock_class *order[LOCK_CLASS_MAX];
+  enum intr_level old_level;
+  size_t cnt, i;
+
+  /* Copy the counters, so that printing does not race with
+     updates or skew the profile. */
+  old_level = intr_disable ();
+  cnt = lock_class_cnt;
+  if (lock_classes[LOCK_CLASS_MAX - 1].name != NULL)
+    cnt = LOCK_CLASS_MAX;
+  memcpy (snapshot, lock_classes, sizeof snapshot);
+  intr_set_level (old_level);
+
+  for (i = 0; i < cnt; i++)
+    order[i] = &snapshot[i];
+  qsort (order, cnt, sizeof *order, lock_class_compare);
+
+  printf ("Lock profile:%27s %9s %9s %6s %9s %6s\n", "acquires",
+          "contended", "wait", "max", "hold", "max");
+  for (i = 0; i < cnt; i++)
+    {
+      const struct lock_class *c = order[i];
+      printf ("  %-28.28s %9lld %9lld %9lld %6lld %9lld %6lld\n",
+              c->name, c->acquires, c->contended, c->wait_ticks,
+              c->wait_max, c->hold_ticks, c->hold_max);
+    }
+}
+#endif /* LOCK_PROFILE */
+
 /* One semaphore in a list. */
 struct semaphore_elem 
   {
-    struct list_elem elem;              /* List element. */
+    struct wait_node node;              /* Node in condition's waiters. */
     struct semaphore semaphore;         /* This semaphore. */
   };
 
@@ -277,7 +558,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  wait_queue_init (&cond->waiters);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -304,6 +585,7 @@ void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -311,15 +593,18 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
-  list_push_back (&cond->waiters, &waiter.elem);
+  waiter.node.thread = thread_current ();
+  old_level = intr_disable ();
+  wait_queue_wait (&cond->waiters, &waiter.node);
+  intr_set_level (old_level);
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals the highest-priority one to wake up from
+   its wait.  LOCK must be held before calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -332,9 +617,16 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+  if (!wait_queue_empty (&cond->waiters)) 
+    {
+      enum intr_level old_level = intr_disable ();
+      struct semaphore_elem *waiter;
+
+      waiter = wait_queue_entry (wait_queue_wake (&cond->waiters),
+                                 struct semaphore_elem, node);
+      intr_set_level (old_level);
+      sema_up (&waiter->semaphore);
+    }
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -349,6 +641,386 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!wait_queue_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+static void rwlock_grant_write (struct rwlock *);
+
+/* Initializes RW as a readers-writer lock.  Any number of
+   threads may hold RW for reading at once, or a single thread
+   may hold it for writing.
+
+   RW prefers writers: once a writer is waiting, new readers
+   wait behind it, so a stream of readers cannot starve writers.
+   Waiting writers are granted RW in priority order, and each
+   grant preempts the releasing thread if it wakes a thread of
+   higher priority.  Unlike a lock, RW has no single owner while
+   it is read, so its holders do not receive priority
+   donations. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  rw->readers = 0;
+  rw->max_readers = 0;
+  rw->writer = NULL;
+  list_init (&rw->read_waiters);
+  wait_queue_init (&rw->write_waiters);
+}
+
+/* Acquires RW for reading, sleeping while it is held or awaited
+   by a writer.  Must not be called within an interrupt
+   handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  old_level = intr_disable ();
+  if (rw->writer == NULL && wait_queue_empty (&rw->write_waiters))
+    {
+      if (++rw->readers > rw->max_readers)
+        rw->max_readers = rw->readers;
+    }
+  else
+    {
+      /* The releasing writer counts us as a reader before it
+         wakes us. */
+      list_push_back (&rw->read_waiters, &thread_current ()->elem);
+      thread_block ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && !wait_queue_empty (&rw->write_waiters))
+    rwlock_grant_write (rw);
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  Must not be called within an interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != cur);
+
+  old_level = intr_disable ();
+  if (rw->writer == NULL && rw->readers == 0)
+    rw->writer = cur;
+  else
+    {
+      /* The releasing thread makes us the writer before it
+         wakes us. */
+      wait_queue_wait (&rw->write_waiters, &cur->waitnode);
+      thread_block ();
+    }
+  ASSERT (rw->writer == cur);
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for writing.
+   Hands RW to the highest-priority waiting writer, if any, or
+   else to every waiting reader. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  old_level = intr_disable ();
+  rw->writer = NULL;
+  if (!wait_queue_empty (&rw->write_waiters))
+    rwlock_grant_write (rw);
+  else if (!list_empty (&rw->read_waiters))
+    {
+      while (!list_empty (&rw->read_waiters))
+        {
+          struct list_elem *e = list_pop_front (&rw->read_waiters);
+          rw->readers++;
+          thread_unblock (list_entry (e, struct thread, elem));
+        }
+      if (rw->readers > rw->max_readers)
+        rw->max_readers = rw->readers;
+      thread_yield_higher ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+/* Makes the highest-priority waiting writer the holder of RW and
+   wakes it.  RW must be free and interrupts must be off. */
+static void
+rwlock_grant_write (struct rwlock *rw)
+{
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (rw->writer == NULL && rw->readers == 0);
+
+  t = wait_queue_wake (&rw->write_waiters)->thread;
+  rw->writer = t;
+  thread_unblock (t);
+  thread_yield_higher ();
+}
+
+/* Wait queues. */
+
+/* Arrival counter for wait nodes, so that waiters of equal
+   priority are woken first-come, first-served. */
+static unsigned wait_seq;
+
+static wait_before_func wait_before;
+static struct wait_node *wait_meld (wait_before_func *, struct wait_node *,
+                                    struct wait_node *);
+static struct wait_node *wait_merge_pairs (wait_before_func *,
+                                           struct wait_node *);
+
+/* Initializes Q as an empty wait queue ordered by priority and
+   then by arrival. */
+void
+wait_queue_init (struct wait_queue *q)
+{
+  wait_queue_init_ordered (q, wait_before);
+}
+
+/* Initializes Q as an empty wait queue that wakes a node A before
+   a node B if BEFORE (A, B) returns true. */
+void
+wait_queue_init_ordered (struct wait_queue *q, wait_before_func *before)
+{
+  ASSERT (q != NULL);
+  ASSERT (before != NULL);
+
+  q->root = NULL;
+  q->before = before;
+}
+
+/* Returns true if no thread is waiting in Q. */
+bool
+wait_queue_empty (const struct wait_queue *q)
+{
+  return q->root == NULL;
+}
+
+/* Returns the node that wait_queue_pop() would return, without
+   removing it, or a null pointer if Q is empty. */
+struct wait_node *
+wait_queue_front (const struct wait_queue *q)
+{
+  return q->root;
+}
+
+/* Adds NODE, whose thread field must be set, to Q.  Interrupts
+   must be off. */
+void
+wait_queue_push (struct wait_queue *q, struct wait_node *node)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  node->seq = wait_seq++;
+  node->child = node->next = node->prev = NULL;
+  q->root = wait_meld (q->before, q->root, node);
+}
+
+/* Removes and returns the highest-priority node in Q, which must
+   not be empty.  Among nodes of equal priority, returns the one
+   pushed first.  Interrupts must be off. */
+struct wait_node *
+wait_queue_pop (struct wait_queue *q)
+{
+  struct wait_node *root = q->root;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (root != NULL);
+
+  q->root = wait_merge_pairs (q->before, root->child);
+  return root;
+}
+
+/* Removes NODE from Q, which must contain it.  Interrupts must
+   be off. */
+void
+wait_queue_remove (struct wait_queue *q, struct wait_node *node)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (node == q->root)
+    {
+      wait_queue_pop (q);
+      return;
+    }
+
+  /* Unlink NODE from its parent and siblings, then merge its
+     children back in. */
+  if (node->prev->child == node)
+    node->prev->child = node->next;
+  else
+    node->prev->next = node->next;
+  if (node->next != NULL)
+    node->next->prev = node->prev;
+  q->root = wait_meld (q->before, q->root,
+                       wait_merge_pairs (q->before, node->child));
+}
+
+/* Returns true if A should be woken before B: default order of a
+   wait queue. */
+static bool
+wait_before (const struct wait_node *a, const struct wait_node *b)
+{
+  if (a->thread->priority != b->thread->priority)
+    return a->thread->priority > b->thread->priority;
+  return (int) (a->seq - b->seq) < 0;
+}
+
+/* Melds the heaps rooted at A and B, neither of which may have
+   siblings, into one ordered by BEFORE and returns its root. */
+static struct wait_node *
+wait_meld (wait_before_func *before, struct wait_node *a,
+           struct wait_node *b)
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+  if (before (b, a))
+    {
+      struct wait_node *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* Make B the leftmost child of A. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Melds the list of sibling heaps starting at FIRST into one
+   heap ordered by BEFORE and returns its root, using the
+   standard two passes: meld adjacent pairs from left to right,
+   then meld the pairs into one heap from right to left. */
+static struct wait_node *
+wait_merge_pairs (wait_before_func *before, struct wait_node *first)
+{
+  struct wait_node *pairs = NULL;
+  struct wait_node *root = NULL;
+
+  /* First pass.  PAIRS collects the results in reverse order,
+     linked through their next fields. */
+  while (first != NULL)
+    {
+      struct wait_node *a = first;
+      struct wait_node *b = a->next;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        {
+          b->next = b->prev = NULL;
+          a = wait_meld (before, a, b);
+        }
+      a->next = pairs;
+      pairs = a;
+    }
+
+  /* Second pass. */
+  while (pairs != NULL)
+    {
+      struct wait_node *next = pairs->next;
+      pairs->next = NULL;
+      root = wait_meld (before, root, pairs);
+      pairs = next;
+    }
+  if (root != NULL)
+    root->prev = NULL;
+  return root;
+}
+
+/* Adds NODE to Q on behalf of its thread, which is about to
+   block.  Unless the thread is already ordered in another wait
+   queue (as a thread in cond_wait() is ordered in the condition
+   variable's queue while it sleeps on a private semaphore),
+   records Q so that a change in the thread's priority moves NODE
+   within Q.  Interrupts must be off. */
+static void
+wait_queue_wait (struct wait_queue *q, struct wait_node *node)
+{
+  struct thread *t = node->thread;
+
+  wait_queue_push (q, node);
+  if (t->waitq == NULL)
+    {
+      t->waitq = q;
+      t->waitq_node = node;
+    }
+}
+
+/* Pops the highest-priority node from Q, which must not be
+   empty, and forgets Q as the place of its thread.  Interrupts
+   must be off. */
+static struct wait_node *
+wait_queue_wake (struct wait_queue *q)
+{
+  struct wait_node *node = wait_queue_pop (q);
+
+  if (node->thread->waitq == q)
+    node->thread->waitq = NULL;
+  return node;
+}
+
+/* Returns the node after N in a walk of every node of Q that
+   starts at wait_queue_front(), or a null pointer if N is the
+   last.  Nodes after the first come in no particular order, and
+   Q must not change during the walk.  This is a preorder walk
+   that climbs back up through the prev fields, so it needs no
+   stack. */
+static struct wait_node *
+wait_queue_next (struct wait_queue *q, struct wait_node *n)
+{
+  if (n->child != NULL)
+    return n->child;
+  while (n != q->root && n->next == NULL)
+    {
+      /* Find N's parent: the prev of N's leftmost sibling. */
+      while (n->prev->child != n)
+        n = n->prev;
+      n = n->prev;
+    }
+  return n != q->root ? n->next : NULL;
+}
+
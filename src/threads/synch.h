@@ -3,12 +3,53 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+/* A thread's place in a wait queue. */
+struct wait_node
+  {
+    struct thread *thread;      /* Waiting thread. */
+    unsigned seq;               /* Arrival order, to break ties. */
+    struct wait_node *child;    /* Leftmost child. */
+    struct wait_node *next;     /* Next sibling. */
+    struct wait_node *prev;     /* Previous sibling, or parent. */
+  };
+
+/* Returns true if node A belongs before node B in a wait queue. */
+typedef bool wait_before_func (const struct wait_node *a,
+                               const struct wait_node *b);
+
+/* Threads waiting on a synchronization object, as a pairing heap
+   ordered by priority and then by arrival, or by another order
+   given to wait_queue_init_ordered().  Pushing a waiter takes
+   constant time, and popping or removing one takes amortized
+   O(log n) time. */
+struct wait_queue
+  {
+    struct wait_node *root;     /* Highest-priority waiter. */
+    wait_before_func *before;   /* Order of the heap. */
+  };
+
+void wait_queue_init (struct wait_queue *);
+void wait_queue_init_ordered (struct wait_queue *, wait_before_func *);
+bool wait_queue_empty (const struct wait_queue *);
+struct wait_node *wait_queue_front (const struct wait_queue *);
+void wait_queue_push (struct wait_queue *, struct wait_node *);
+struct wait_node *wait_queue_pop (struct wait_queue *);
+void wait_queue_remove (struct wait_queue *, struct wait_node *);
+
+/* Converts pointer to wait node NODE into a pointer to the
+   structure that NODE is embedded inside. */
+#define wait_queue_entry(NODE, STRUCT, MEMBER)                  \
+        ((STRUCT *) ((uint8_t *) (NODE) - offsetof (STRUCT, MEMBER)))
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct wait_queue waiters;  /* Waiting threads. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -22,18 +63,30 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+#ifdef LOCK_PROFILE
+    struct lock_class *class;   /* Profile shared by locks of this name. */
+    int64_t acquired_at;        /* Tick at which holder acquired it. */
+#endif
   };
 
-void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_print_stats (void);
+#ifdef LOCK_PROFILE
+void lock_profile_print (void);
+#endif
+
+/* Initializes LOCK, naming it after the expression that
+   designates it, e.g. "&file_lock", for the lock profiler. */
+#define lock_init(LOCK) lock_init_named (LOCK, #LOCK)
 
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct wait_queue waiters;  /* Waiting threads. */
   };
 
 void cond_init (struct condition *);
@@ -41,6 +94,23 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock
+  {
+    int readers;                /* Number of threads reading. */
+    struct thread *writer;      /* Thread writing, or NULL. */
+    struct list read_waiters;   /* Threads waiting to read. */
+    struct wait_queue write_waiters; /* Threads waiting to write. */
+    int max_readers;            /* Most threads ever reading at once. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
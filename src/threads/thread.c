@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
@@ -11,6 +12,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "lib/kernel/hash.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -21,15 +23,36 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-struct list ready_list;
-struct list sleep_list;
+/* Run queue of threads in THREAD_READY state, that is, threads
+   that are ready to run but not actually running.  There is one
+   FIFO list per priority level, and bit P of BITMAP is set iff
+   QUEUES[P] is non-empty, so that inserting a thread, picking the
+   next one to run and testing for preemption all take constant
+   time.  Threads in the EDF class are kept apart in EDF, ordered
+   by deadline, and take precedence over all of QUEUES.  Under the
+   stride scheduler, STRIDE replaces QUEUES.  Accessed with
+   interrupts off. */
+struct ready_queue
+  {
+    struct list edf;                    /* EDF threads, by deadline. */
+    struct list queues[PRI_MAX + 1];    /* One FIFO per priority. */
+    struct wait_queue stride;           /* Stride threads, by pass. */
+    int64_t pass;                       /* Highest pass dispatched. */
+    uint64_t bitmap;                    /* Non-empty levels. */
+    size_t cnt;                         /* Number of threads queued. */
+  };
+static struct ready_queue ready_queue;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
+/* Index of live threads by tid, for get_id_thread().  A thread
+   is added as soon as its tid is allocated and removed when it
+   calls thread_exit(), i.e. at the same points as all_list. */
+static struct hash tid_table;
+static struct lock tid_table_lock;
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -51,6 +74,9 @@ struct kernel_thread_frame
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+static long long tid_lookups;   /* # of get_id_thread() calls. */
+static long long tid_probes;    /* # of tid comparisons they made. */
+static long long tid_compares;  /* # of tid comparisons in all. */
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
@@ -61,6 +87,50 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Stride scheduler.  Each thread advances its pass by its stride,
+   STRIDE1 / tickets, for every tick it runs, and the ready thread
+   with the lowest pass runs next, so that over time each thread
+   gets CPU in proportion to its tickets.  A thread that becomes
+   ready with a pass behind the run queue's is moved up to it, so
+   that time spent blocked does not bank credit. */
+bool thread_stride;
+#define STRIDE1 (1 << 20)
+
+/* Cache of the pages of recently destroyed threads, which
+   thread_create() reuses before asking palloc for a new page.
+   This keeps thread creation off the kernel pool's lock and its
+   first-fit bitmap scan.  Accessed with interrupts off, since
+   pages are added from thread_schedule_tail(). */
+#define THREAD_CACHE_MAX 32
+static void *thread_cache[THREAD_CACHE_MAX];
+static size_t thread_cache_cnt;
+size_t thread_cache_prewarm;
+
+/* Multi-level feedback queue scheduler. */
+#define MLFQS_PRI_INTERVAL 4    /* Recompute priorities every 4 ticks. */
+static fixed_t load_avg;        /* System load average. */
+
+/* Threads whose recent_cpu changed since priorities were last
+   recomputed.  Between the once-per-second decay of every
+   thread's recent_cpu, only threads that actually ran are
+   charged CPU time, so only they need a new priority every
+   MLFQS_PRI_INTERVAL ticks. */
+static struct list mlfqs_dirty_list;
+
+/* Earliest-deadline-first scheduling class.  A thread joins it
+   with thread_set_deadline(), asking for EDF_BUDGET ticks of CPU
+   in every EDF_PERIOD ticks.  Ready EDF threads run before any
+   other thread, earliest deadline first; one that uses up its
+   budget is throttled, i.e. not run again until its next period
+   begins, so that it cannot starve the other classes.  The
+   deadline of each period is its end.
+
+   EDF_LIST holds every thread in the class, so that thread_tick()
+   can start their new periods, and EDF_UTIL is the sum of their
+   utilizations.  Both are accessed with interrupts off. */
+static struct list edf_list;
+static int edf_util;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -72,21 +142,28 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
-
-
-static bool
-thread_higher_priority(struct list_elem *a, struct list_elem *b, void* aux){
-  struct thread* a_thread = list_entry(a, struct thread, elem);
-  struct thread* b_thread = list_entry(b, struct thread, elem);
-  return a_thread->priority > b_thread->priority;
-}
-
-static bool
-thread_lower_priority(struct list_elem *a, struct list_elem *b, void* aux){
-  struct thread* a_thread = list_entry(a, struct thread, elem);
-  struct thread* b_thread = list_entry(b, struct thread, elem);
-  return a_thread->priority < b_thread->priority;
-}
+static void ready_queue_init (void);
+static void ready_queue_push (struct thread *);
+static struct thread *ready_queue_pop (void);
+static int ready_queue_max_priority (void);
+static void ready_queue_remove (struct thread *);
+static bool ready_queue_preempts (const struct thread *);
+static bool edf_runnable (const struct thread *);
+static list_less_func edf_less;
+static void edf_tick (struct thread *, int64_t now);
+static void edf_leave (struct thread *);
+static wait_before_func stride_before;
+static void stride_tick (struct thread *);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_update_priority (struct thread *);
+static void mlfqs_decay_recent_cpu (struct thread *, void *aux);
+static hash_hash_func tid_hash;
+static hash_less_func tid_less;
+static void tid_table_insert (struct thread *);
+static struct thread *tid_find (tid_t);
+static struct thread *thread_page_alloc (void);
+static void thread_page_free (struct thread *);
+static void print_thread_stats (struct thread *, void *aux);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -107,9 +184,12 @@ thread_init (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&sleep_list);
-  list_init (&ready_list);
+  lock_init (&tid_table_lock);
+  ready_queue_init ();
   list_init (&all_list);
+  list_init (&mlfqs_dirty_list);
+  list_init (&edf_list);
+  load_avg = fp_from_int (0);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -123,6 +203,21 @@ thread_init (void)
 void
 thread_start (void) 
 {
+  /* Now that malloc() works, set up the tid index. */
+  if (!hash_init (&tid_table, tid_hash, tid_less, NULL))
+    PANIC ("cannot allocate tid index");
+  tid_table_insert (initial_thread);
+
+  /* Fill the thread page cache as requested by -threadcache. */
+  while (thread_cache_cnt < thread_cache_prewarm
+         && thread_cache_cnt < THREAD_CACHE_MAX)
+    {
+      void *page = palloc_get_page (0);
+      if (page == NULL)
+        break;
+      thread_cache[thread_cache_cnt++] = page;
+    }
+
   /* Create the idle thread. */
   struct semaphore idle_started;
   sema_init (&idle_started, 0);
@@ -135,20 +230,19 @@ thread_start (void)
   sema_down (&idle_started);
 }
 
+/* Yields the CPU if some ready thread should run before the
+   running thread: an EDF thread with an earlier deadline, or,
+   failing that, a thread of higher priority.  From an interrupt
+   handler, the yield is deferred until the handler returns. */
 void 
 thread_yield_higher(void){
   enum intr_level old_level = intr_disable ();
 
-  if (!list_empty (&ready_list)) {
-    struct thread *cur = thread_current ();
-    struct thread *max = list_entry (list_max (&ready_list,
-          thread_lower_priority, NULL), struct thread, elem);
-    if (max->priority > cur->priority) {
-      if (intr_context ()) 
-        intr_yield_on_return ();
-      else
-        thread_yield ();
-    }
+  if (ready_queue_preempts (thread_current ())) {
+    if (intr_context ()) 
+      intr_yield_on_return ();
+    else
+      thread_yield ();
   }
   intr_set_level (old_level);
 }
@@ -169,36 +263,49 @@ thread_tick (void)
 #endif
   else
     kernel_ticks++;
+  t->stats.run_ticks++;
+
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+  else if (thread_stride)
+    stride_tick (t);
+  if (!list_empty (&edf_list))
+    edf_tick (t, timer_ticks ());
 
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
-
-  enum intr_level old_level = intr_disable();
-
-  struct list_elem* e;
-  if(!list_empty(&sleep_list)){
-    for(e = list_begin(&sleep_list); e != list_end(&sleep_list); ){
-      struct thread* t = list_entry(e, struct thread, sleepelem);
-      e = list_next(e);
-      if(t->time_to_wake <= timer_ticks()){
-        sema_up(&t->sema);
-        list_remove(&t->sleepelem);
-      }
-      else
-        break;
-    }
-  }
-
-  intr_set_level (old_level);
 }
 
 /* Prints thread statistics. */
 void
 thread_print_stats (void) 
 {
+  enum intr_level old_level;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld tid lookups, %lld tid comparisons\n",
+          tid_lookups, tid_probes);
+
+  old_level = intr_disable ();
+  thread_foreach (print_thread_stats, NULL);
+  intr_set_level (old_level);
+}
+
+/* Prints T's scheduler accounting.  Used by thread_print_stats()
+   via thread_foreach(). */
+static void
+print_thread_stats (struct thread *t, void *aux UNUSED)
+{
+  const struct sched_stats *s = &t->stats;
+
+  printf ("Thread %d (%s): %lld run, %lld ready, %lld blocked ticks; "
+          "%lld us run; "
+          "%lld scheduled, %lld voluntary, %lld involuntary\n",
+          t->tid, t->name, s->run_ticks, s->ready_ticks, s->blocked_ticks,
+          s->run_ns / 1000,
+          s->sched_cnt, s->voluntary_cnt, s->involuntary_cnt);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -230,20 +337,19 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_alloc ();
   if (t == NULL){
     return TID_ERROR;
   }
 
-  /* Initialize thread. */
+  /* Initialize thread.  Under MLFQS, PRIORITY is ignored and
+     derived from the inherited nice and recent_cpu instead, except
+     for the idle thread, which must stay at PRI_MIN. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
-
-#ifdef USERPROG
-  t->parent_id = ((struct id_passer*) aux)->tid;
-#endif
-
-  palloc_free_page (((struct id_passer*) aux)->free);
+  tid_table_insert (t);
+  if (thread_mlfqs && function != idle)
+    mlfqs_update_priority (t);
 
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack' 
@@ -301,12 +407,16 @@ void
 thread_unblock (struct thread *t) 
 {
   enum intr_level old_level;
+  int64_t now;
 
   ASSERT (is_thread (t));
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_insert_ordered (&ready_list, &t->elem, thread_higher_priority, NULL);
+  now = timer_ticks ();
+  t->stats.blocked_ticks += now - t->state_since;
+  t->state_since = now;
+  ready_queue_push (t);
   t->status = THREAD_READY;
   intr_set_level (old_level);
 }
@@ -360,10 +470,17 @@ thread_exit (void)
 #ifdef USERPROG
   process_exit ();
 #endif
-  
-  
+
+  lock_acquire (&tid_table_lock);
+  hash_delete (&tid_table, &thread_current ()->tidelem.elem);
+  lock_release (&tid_table_lock);
+
   intr_disable ();
   list_remove (&thread_current()->allelem);
+  if (thread_current ()->mlfqs_dirty)
+    list_remove (&thread_current ()->mlfqs_elem);
+  if (thread_current ()->edf_period != 0)
+    edf_leave (thread_current ());
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -381,7 +498,7 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) 
-    list_insert_ordered (&ready_list, &cur->elem, thread_higher_priority, NULL);
+    ready_queue_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
@@ -404,17 +521,35 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY.  Its
+   effective priority becomes the higher of that and the highest
+   priority donated to it.  The running thread is never on the
+   run queue, so nothing needs to be re-queued; we only have to
+   check whether some ready thread now outranks us. */
 void
 thread_set_priority (int new_priority) 
 {
   enum intr_level old_level;
+  struct list_elem *e;
+
+  /* The MLFQS scheduler manages priorities itself. */
+  if (thread_mlfqs)
+    return;
+
   old_level = intr_disable ();
 
   struct thread *cur = thread_current ();
-  cur->priority = new_priority;
+  int priority = new_priority;
+  cur->base_priority = new_priority;
+  for (e = list_begin (&cur->donors); e != list_end (&cur->donors);
+       e = list_next (e))
+    {
+      struct thread *donor = list_entry (e, struct thread, donor_elem);
+      if (donor->priority > priority)
+        priority = donor->priority;
+    }
+  thread_change_priority (cur, priority);
 
-  list_sort(&ready_list, thread_higher_priority, NULL);
   thread_yield_higher ();
   intr_set_level (old_level);
 }
@@ -426,46 +561,388 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
+/* Sets T's effective priority to PRIORITY, moving T to its new
+   run queue level if it is ready and to its new place among the
+   waiters of the wait queue it is ordered in, if any.  A thread
+   in cond_wait() is ordered in the condition's queue even before
+   it blocks.  Used for priority donation and by the MLFQS
+   scheduler.  Interrupts must be off if T may be ready or
+   waiting. */
+void
+thread_change_priority (struct thread *t, int priority)
+{
+  ASSERT (is_thread (t));
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  if (priority == t->priority)
+    return;
+  if (t->status == THREAD_READY)
+    ready_queue_remove (t);
+  if (t->waitq != NULL)
+    wait_queue_remove (t->waitq, t->waitq_node);
+  t->priority = priority;
+  if (t->status == THREAD_READY)
+    ready_queue_push (t);
+  if (t->waitq != NULL)
+    wait_queue_push (t->waitq, t->waitq_node);
+}
+
+/* Puts the running thread in the earliest-deadline-first class,
+   asking for BUDGET timer ticks of CPU in every PERIOD ticks,
+   starting now.  A PERIOD of 0 returns the thread to the
+   priority class.  Returns false, changing nothing, if the
+   arguments are invalid or if admitting the thread would raise
+   the total utilization of EDF threads above EDF_UTIL_MAX. */
+bool
+thread_set_deadline (int64_t period, int64_t budget)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int util = 0;
+  bool ok = false;
+
+  ASSERT (!intr_context ());
+
+  if (period < 0 || (period > 0 && (budget <= 0 || budget > period)))
+    return false;
+  if (period > 0)
+    util = DIV_ROUND_UP (budget * 1000, period);
+
+  old_level = intr_disable ();
+  if (edf_util - cur->edf_util + util <= EDF_UTIL_MAX)
+    {
+      if (cur->edf_period != 0)
+        edf_leave (cur);
+      if (period > 0)
+        {
+          cur->edf_period = period;
+          cur->edf_budget = budget;
+          cur->edf_deadline = timer_ticks () + period;
+          cur->edf_used = 0;
+          cur->edf_util = util;
+          cur->edf_throttled = false;
+          edf_util += util;
+          list_push_back (&edf_list, &cur->edf_elem);
+        }
+      ok = true;
+    }
+
+  /* Leaving the class may let a ready thread outrank us. */
+  thread_yield_higher ();
+  intr_set_level (old_level);
+  return ok;
+}
+
+/* Removes T from the EDF class.  Interrupts must be off. */
+static void
+edf_leave (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->edf_period != 0);
+
+  list_remove (&t->edf_elem);
+  edf_util -= t->edf_util;
+  t->edf_period = 0;
+  t->edf_util = 0;
+  t->edf_throttled = false;
+}
+
+/* Charges running thread CUR for a tick if it is in the EDF
+   class, throttling it once its budget is used up, and starts a
+   new period for each EDF thread whose deadline has passed.  A
+   thread that missed whole periods starts afresh at NOW instead
+   of accumulating them.  Called from thread_tick(). */
+static void
+edf_tick (struct thread *cur, int64_t now)
+{
+  struct list_elem *e;
+
+  ASSERT (intr_context ());
+
+  if (cur->edf_period != 0 && !cur->edf_throttled
+      && ++cur->edf_used >= cur->edf_budget)
+    {
+      cur->edf_throttled = true;
+      intr_yield_on_return ();
+    }
+
+  for (e = list_begin (&edf_list); e != list_end (&edf_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, edf_elem);
+
+      if (t->edf_deadline > now)
+        continue;
+      if (t->status == THREAD_READY)
+        ready_queue_remove (t);
+      t->edf_deadline += t->edf_period;
+      if (t->edf_deadline <= now)
+        t->edf_deadline = now + t->edf_period;
+      t->edf_used = 0;
+      t->edf_throttled = false;
+      if (t->status == THREAD_READY)
+        ready_queue_push (t);
+    }
+
+  if (ready_queue_preempts (cur))
+    intr_yield_on_return ();
+}
+
+/* Returns the live thread whose tid is ID, or a null pointer if
+   there is none.  Uses the tid index, so takes constant expected
+   time regardless of the number of threads. */
 struct thread* 
 get_id_thread (tid_t id) {
-  struct list_elem *e;
-  for (e = list_begin (&all_list); e != list_end (&all_list);
-       e = list_next (e)){
-      struct thread *t = list_entry (e, struct thread, allelem);
-      if (t->tid == id) return t;
-  }
-  return NULL;
+  struct thread *t;
+
+  lock_acquire (&tid_table_lock);
+  t = tid_find (id);
+  lock_release (&tid_table_lock);
+  return t;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Copies the scheduler accounting of the thread with identifier
+   TID into *STATS.  Returns false if there is no such thread. */
+bool
+thread_get_stats (tid_t tid, struct sched_stats *stats)
+{
+  struct thread *t;
+
+  /* thread_exit() removes a thread from the tid index under
+     tid_table_lock before it dies, so holding the lock keeps T's
+     page from being freed and reused while we copy.  Interrupts
+     are off only so the copy sees a consistent snapshot. */
+  lock_acquire (&tid_table_lock);
+  t = tid_find (tid);
+  if (t != NULL)
+    {
+      enum intr_level old_level = intr_disable ();
+
+      *stats = t->stats;
+      if (t->status == THREAD_RUNNING)
+        stats->run_ns += timer_ns () - t->dispatch_ns;
+      intr_set_level (old_level);
+    }
+  lock_release (&tid_table_lock);
+
+  return t != NULL;
+}
+
+/* Adds T, whose tid has been allocated, to the tid index. */
+static void
+tid_table_insert (struct thread *t)
+{
+  t->tidelem.tid = t->tid;
+  lock_acquire (&tid_table_lock);
+  hash_insert (&tid_table, &t->tidelem.elem);
+  lock_release (&tid_table_lock);
+}
+
+/* Returns the live thread whose tid is ID, or a null pointer if
+   there is none, counting the lookup and the comparisons it
+   makes.  tid_table_lock must be held. */
+static struct thread *
+tid_find (tid_t id)
+{
+  struct tid_elem key;
+  long long compares = tid_compares;
+  struct hash_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&tid_table_lock));
+
+  key.tid = id;
+  e = hash_find (&tid_table, &key.elem);
+  tid_lookups++;
+  tid_probes += tid_compares - compares;
+  return e != NULL ? hash_entry (e, struct thread, tidelem.elem) : NULL;
+}
+
+/* Returns a hash value for the thread containing E. */
+static unsigned
+tid_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct tid_elem, elem)->tid);
+}
+
+/* Returns true if tid index element A's tid is less than B's. */
+static bool
+tid_less (const struct hash_elem *a, const struct hash_elem *b,
+          void *aux UNUSED)
+{
+  tid_compares++;
+  return (hash_entry (a, struct tid_elem, elem)->tid
+          < hash_entry (b, struct tid_elem, elem)->tid);
+}
+
+/* Sets the current thread's nice value to NICE, recomputes its
+   priority and yields if it no longer has the highest one. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  thread_current ()->nice = nice;
+  if (thread_mlfqs)
+    {
+      mlfqs_update_priority (thread_current ());
+      thread_yield_higher ();
+    }
+  intr_set_level (old_level);
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int result = fp_round (fp_mul_int (load_avg, 100));
+  intr_set_level (old_level);
+  return result;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int result = fp_round (fp_mul_int (thread_current ()->recent_cpu, 100));
+  intr_set_level (old_level);
+  return result;
+}
+
+/* Returns the current thread's tickets. */
+int
+thread_get_tickets (void) 
+{
+  return thread_current ()->tickets;
+}
+
+/* Sets the current thread's tickets to TICKETS, its share of the
+   CPU under the stride scheduler. */
+void
+thread_set_tickets (int tickets) 
+{
+  ASSERT (TICKETS_MIN <= tickets && tickets <= TICKETS_MAX);
+
+  thread_current ()->tickets = tickets;
+}
+
+/* Stride bookkeeping for one timer tick, with T the running
+   thread: charges T a stride and preempts it as soon as another
+   ready thread has a lower pass. */
+static void
+stride_tick (struct thread *t)
+{
+  if (t == idle_thread)
+    return;
+  t->pass += STRIDE1 / t->tickets;
+  if (ready_queue_preempts (t))
+    intr_yield_on_return ();
+}
+
+/* Orders stride threads by pass, then by arrival. */
+static bool
+stride_before (const struct wait_node *a, const struct wait_node *b)
+{
+  if (a->thread->pass != b->thread->pass)
+    return a->thread->pass < b->thread->pass;
+  return (int) (a->seq - b->seq) < 0;
+}
+
+/* MLFQS bookkeeping for one timer tick, with T the running
+   thread.  Charges the tick to T, and once per second updates
+   load_avg and decays every thread's recent_cpu.  Every
+   MLFQS_PRI_INTERVAL ticks recomputes the priority of the threads
+   whose recent_cpu changed.  Runs in the timer interrupt. */
+static void
+mlfqs_tick (struct thread *t)
+{
+  int64_t now = timer_ticks ();
+
+  if (t != idle_thread)
+    {
+      t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+      if (!t->mlfqs_dirty)
+        {
+          t->mlfqs_dirty = true;
+          list_push_back (&mlfqs_dirty_list, &t->mlfqs_elem);
+        }
+    }
+
+  if (now % TIMER_FREQ == 0)
+    {
+      int ready_threads = ready_queue.cnt + (t != idle_thread ? 1 : 0);
+
+      load_avg = fp_add (fp_mul (fp_div_int (fp_from_int (59), 60), load_avg),
+                         fp_mul_int (fp_div_int (fp_from_int (1), 60),
+                                     ready_threads));
+
+      fixed_t twice_load = fp_mul_int (load_avg, 2);
+      fixed_t decay = fp_div (twice_load, fp_add_int (twice_load, 1));
+
+      /* Every thread's recent_cpu, and hence its priority, has
+         changed, so the dirty list is subsumed. */
+      thread_foreach (mlfqs_decay_recent_cpu, &decay);
+      while (!list_empty (&mlfqs_dirty_list))
+        list_entry (list_pop_front (&mlfqs_dirty_list),
+                    struct thread, mlfqs_elem)->mlfqs_dirty = false;
+      thread_yield_higher ();
+    }
+  else if (now % MLFQS_PRI_INTERVAL == 0)
+    {
+      while (!list_empty (&mlfqs_dirty_list))
+        {
+          struct thread *d = list_entry (list_pop_front (&mlfqs_dirty_list),
+                                         struct thread, mlfqs_elem);
+          d->mlfqs_dirty = false;
+          mlfqs_update_priority (d);
+        }
+      thread_yield_higher ();
+    }
+}
+
+/* Decays T's recent_cpu by the factor pointed to by DECAY_ and
+   recomputes its priority.  Called once per second for every
+   thread. */
+static void
+mlfqs_decay_recent_cpu (struct thread *t, void *decay_)
+{
+  fixed_t *decay = decay_;
+
+  if (t == idle_thread)
+    return;
+  t->recent_cpu = fp_add_int (fp_mul (*decay, t->recent_cpu), t->nice);
+  mlfqs_update_priority (t);
+}
+
+/* Recomputes T's priority from its recent_cpu and nice values,
+   moving T to its new run queue level if it is ready. */
+static void
+mlfqs_update_priority (struct thread *t)
+{
+  int priority;
+
+  if (t == idle_thread)
+    return;
+
+  priority = fp_to_int (fp_sub (fp_from_int (PRI_MAX - t->nice * 2),
+                                fp_div_int (t->recent_cpu, 4)));
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+
+  thread_change_priority (t, priority);
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -565,8 +1042,25 @@ init_thread (struct thread *t, const char *name, int priority)
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
+  t->base_priority = priority;
+  list_init (&t->donors);
+  t->waitnode.thread = t;
   t->magic = THREAD_MAGIC;
-  t->mapid = 0;
+  t->state_since = timer_ticks ();
+
+  /* A new thread inherits its parent's nice, recent_cpu and
+     tickets. */
+  t->nice = NICE_DEFAULT;
+  t->recent_cpu = fp_from_int (0);
+  t->tickets = TICKETS_DEFAULT;
+  t->stridenode.thread = t;
+  if (t != initial_thread)
+    {
+      struct thread *parent = running_thread ();
+      t->nice = parent->nice;
+      t->recent_cpu = parent->recent_cpu;
+      t->tickets = parent->tickets;
+    }
   list_push_back (&all_list, &t->allelem);
 }
 
@@ -583,6 +1077,196 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
+/* Initializes the run queue to empty. */
+static void
+ready_queue_init (void)
+{
+  struct ready_queue *rq = &ready_queue;
+  int pri;
+
+  list_init (&rq->edf);
+  for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+    list_init (&rq->queues[pri]);
+  wait_queue_init_ordered (&rq->stride, stride_before);
+  rq->pass = 0;
+  rq->bitmap = 0;
+  rq->cnt = 0;
+}
+
+/* Appends T to the run queue level for its priority and marks
+   that level non-empty, or, if T is in the EDF class, inserts it
+   among the EDF threads by deadline, or, under the stride
+   scheduler, adds it to the stride heap.  Interrupts must be
+   off. */
+static void
+ready_queue_push (struct thread *t)
+{
+  struct ready_queue *rq = &ready_queue;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  if (t->edf_period != 0)
+    list_insert_ordered (&rq->edf, &t->elem, edf_less, NULL);
+  else if (thread_stride)
+    {
+      if (t->pass < rq->pass)
+        t->pass = rq->pass;
+      wait_queue_push (&rq->stride, &t->stridenode);
+    }
+  else
+    {
+      list_push_back (&rq->queues[t->priority], &t->elem);
+      rq->bitmap |= (uint64_t) 1 << t->priority;
+    }
+  rq->cnt++;
+}
+
+/* Removes ready thread T from the run queue, clearing its level's
+   bit if that level becomes empty.  Interrupts must be off. */
+static void
+ready_queue_remove (struct thread *t)
+{
+  struct ready_queue *rq = &ready_queue;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  if (t->edf_period != 0)
+    list_remove (&t->elem);
+  else if (thread_stride)
+    wait_queue_remove (&rq->stride, &t->stridenode);
+  else
+    {
+      list_remove (&t->elem);
+      if (list_empty (&rq->queues[t->priority]))
+        rq->bitmap &= ~((uint64_t) 1 << t->priority);
+    }
+  rq->cnt--;
+}
+
+/* Returns the highest priority level that has a ready thread,
+   or PRI_MIN - 1 if the run queue is empty.  The bitmap is
+   scanned one 32-bit half at a time so that __builtin_clz()
+   compiles to a single BSR instruction. */
+static int
+ready_queue_max_priority (void)
+{
+  uint64_t bitmap = ready_queue.bitmap;
+  uint32_t high = bitmap >> 32;
+  uint32_t low = (uint32_t) bitmap;
+
+  if (high != 0)
+    return 63 - __builtin_clz (high);
+  else if (low != 0)
+    return 31 - __builtin_clz (low);
+  else
+    return PRI_MIN - 1;
+}
+
+/* Returns the ready EDF thread with the earliest deadline that
+   is not throttled, or a null pointer if there is none. */
+static struct thread *
+ready_queue_edf_first (void)
+{
+  struct ready_queue *rq = &ready_queue;
+  struct list_elem *e;
+
+  for (e = list_begin (&rq->edf); e != list_end (&rq->edf);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, elem);
+      if (!t->edf_throttled)
+        return t;
+    }
+  return NULL;
+}
+
+/* Returns true if some ready thread should run before CUR: an
+   EDF thread with an earlier deadline, or, if neither has one, a
+   thread of higher priority or, under the stride scheduler, of
+   lower pass.  Interrupts must be off. */
+static bool
+ready_queue_preempts (const struct thread *cur)
+{
+  struct thread *first = ready_queue_edf_first ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (edf_runnable (cur))
+    return first != NULL && first->edf_deadline < cur->edf_deadline;
+  else if (first != NULL)
+    return true;
+  else if (thread_stride)
+    {
+      struct wait_node *next = wait_queue_front (&ready_queue.stride);
+      return next != NULL
+             && (cur == idle_thread || next->thread->pass < cur->pass);
+    }
+  else
+    return ready_queue_max_priority () > cur->priority;
+}
+
+/* Removes and returns the unthrottled EDF thread with the
+   earliest deadline, or failing that the first thread of the
+   highest non-empty priority level (the thread with the lowest
+   pass, under the stride scheduler), or a null pointer if the run
+   queue has neither.  Throttled EDF threads stay queued until
+   edf_tick() starts their next period. */
+static struct thread *
+ready_queue_pop (void)
+{
+  struct ready_queue *rq = &ready_queue;
+  struct thread *t = ready_queue_edf_first ();
+  int pri = ready_queue_max_priority ();
+
+  if (t != NULL)
+    {
+      list_remove (&t->elem);
+      rq->cnt--;
+    }
+  else if (thread_stride)
+    {
+      if (!wait_queue_empty (&rq->stride))
+        {
+          t = wait_queue_pop (&rq->stride)->thread;
+          if (t->pass > rq->pass)
+            rq->pass = t->pass;
+          rq->cnt--;
+        }
+    }
+  else if (pri >= PRI_MIN)
+    {
+      t = list_entry (list_pop_front (&rq->queues[pri]),
+                      struct thread, elem);
+      if (list_empty (&rq->queues[pri]))
+        rq->bitmap &= ~((uint64_t) 1 << pri);
+      rq->cnt--;
+    }
+  return t;
+}
+
+/* Returns true if T is in the EDF class and has budget left in
+   its current period. */
+static bool
+edf_runnable (const struct thread *t)
+{
+  return t->edf_period != 0 && !t->edf_throttled;
+}
+
+/* Orders threads by EDF deadline, earliest first.  Threads with
+   equal deadlines keep FIFO order, since list_insert_ordered()
+   inserts after them. */
+static bool
+edf_less (const struct list_elem *a_, const struct list_elem *b_,
+          void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->edf_deadline < b->edf_deadline;
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
@@ -591,10 +1275,9 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+  struct thread *next = ready_queue_pop ();
+
+  return next != NULL ? next : idle_thread;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -639,7 +1322,7 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_page_free (prev);
     }
 }
 
@@ -662,10 +1345,55 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      int64_t now = timer_ticks ();
+      int64_t now_ns = timer_ns ();
+
+      cur->stats.run_ns += now_ns - cur->dispatch_ns;
+      next->dispatch_ns = now_ns;
+      if (cur->status == THREAD_READY)
+        cur->stats.involuntary_cnt++;
+      else
+        cur->stats.voluntary_cnt++;
+      cur->state_since = now;
+      next->stats.ready_ticks += now - next->state_since;
+      next->stats.sched_cnt++;
+
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
+/* Returns a page for a new thread, from the thread page cache
+   if possible, or a null pointer if memory is exhausted.  The
+   page is not zeroed: init_thread() clears the `struct thread'
+   and the rest of the page is only ever used as stack. */
+static struct thread *
+thread_page_alloc (void)
+{
+  enum intr_level old_level = intr_disable ();
+  void *page = NULL;
+
+  if (thread_cache_cnt > 0)
+    page = thread_cache[--thread_cache_cnt];
+  intr_set_level (old_level);
+
+  return page != NULL ? page : palloc_get_page (0);
+}
+
+/* Releases dead thread T's page to the thread page cache, or to
+   palloc if the cache is full.  Interrupts must be off. */
+static void
+thread_page_free (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_cache_cnt < THREAD_CACHE_MAX)
+    thread_cache[thread_cache_cnt++] = t;
+  else
+    palloc_free_page (t);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) 
@@ -4,7 +4,9 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include <sched-stats.h>
 #include "threads/synch.h"
+#include "threads/fixed-point.h"
 #include "filesys/file.h"
 #include "lib/kernel/hash.h"
 
@@ -27,6 +29,25 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the multi-level feedback queue scheduler. */
+#define NICE_MIN -20                    /* Nicest. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
+/* Thread tickets, for the stride scheduler. */
+#define TICKETS_MIN 1                   /* Smallest CPU share. */
+#define TICKETS_DEFAULT 100             /* Default CPU share. */
+#define TICKETS_MAX 10000               /* Largest CPU share. */
+
+/* Element of the tid index.  It keeps its own copy of the tid so
+   that a lookup key is this small struct, not a whole struct
+   thread on the caller's kernel stack. */
+struct tid_elem
+  {
+    tid_t tid;                          /* Same as the thread's tid. */
+    struct hash_elem elem;              /* Hash table element. */
+  };
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -85,42 +106,78 @@ typedef int tid_t;
    blocked state is on a semaphore wait list. */
 struct thread
   {
-    int64_t time_to_wake;
-    struct list_elem sleepelem;
-    struct semaphore sema;
+    /* Owned by devices/timer.c. */
+    int64_t time_to_wake;               /* Tick to wake up at, or -1. */
+    struct list_elem sleepelem;         /* Element in timing wheel. */
+    struct semaphore sema;              /* Upped to end a sleep. */
 
     /* Owned by thread.c. */
     tid_t tid;                          /* Thread identifier. */
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Effective priority. */
+    int base_priority;                  /* Priority before donations. */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct tid_elem tidelem;            /* Element in tid index. */
+    struct sched_stats stats;           /* Scheduler accounting. */
+    int64_t state_since;                /* Tick of last READY/BLOCKED
+                                           transition. */
+    int64_t dispatch_ns;                /* timer_ns() when last
+                                           scheduled. */
+
+    /* Multi-level feedback queue scheduler (thread.c). */
+    int nice;                           /* Niceness. */
+    fixed_t recent_cpu;                 /* Recent CPU time, decayed. */
+    bool mlfqs_dirty;                   /* recent_cpu changed since last
+                                           priority recomputation? */
+    struct list_elem mlfqs_elem;        /* Element in dirty list. */
+
+    /* Earliest-deadline-first class (thread.c).  EDF_PERIOD is 0
+       for threads scheduled by priority. */
+    int64_t edf_period;                 /* Period, in timer ticks. */
+    int64_t edf_budget;                 /* Ticks of CPU per period. */
+    int64_t edf_deadline;               /* End of current period. */
+    int64_t edf_used;                   /* Ticks run this period. */
+    int edf_util;                       /* Budget/period, per mille. */
+    bool edf_throttled;                 /* Budget used up? */
+    struct list_elem edf_elem;          /* Element in edf_list. */
+
+    /* Stride scheduler (thread.c). */
+    int tickets;                        /* Share of the CPU. */
+    int64_t pass;                       /* Virtual time of next run. */
+    struct wait_node stridenode;        /* Node in run queue's heap. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct wait_node waitnode;          /* Node in a semaphore's waiters. */
+    struct wait_queue *waitq;           /* Wait queue we are ordered in
+                                           while blocked, or NULL. */
+    struct wait_node *waitq_node;       /* Our node in WAITQ. */
+
+    /* Priority donation (synch.c). */
+    struct list donors;                 /* Threads waiting on our locks. */
+    struct list_elem donor_elem;        /* Element in holder's donors. */
+    struct lock *waiting_lock;          /* Lock we are blocked on. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
-    uint32_t *pagedir;                  /* Page directory. */
+    uint32_t *pagedir;                  /* Page directory, owned by
+                                           PROCESS. */
+    struct process *process;            /* Process we belong to. */
+    uint8_t *ustack_top;                /* Our user stack region. */
+    uint8_t *ustack_limit;
 
     /* for control children */
     int load_status;
     struct list children;
 
-    struct file* executing_file;
-
     /* synch items */
     struct lock child_lock;
     struct condition child_cond;
 
     tid_t parent_id;
 
-    /* for project 3 */
-    struct hash sup_page_table;
-    struct hash mmfiles;
-    int mapid;
-
 #endif
 
     /* Owned by thread.c. */
@@ -131,18 +188,31 @@ struct child_info{
   tid_t child_id;
   bool exit_normally;
   bool waited_before;
+  bool exited;
   int exit_status;
   struct list_elem elem;
 };
 
-struct list ready_list;
-struct list sleep_list;
-
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the stride scheduler, which shares the CPU among
+   threads in proportion to their tickets.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
+/* Highest total utilization, in parts per thousand, that
+   thread_set_deadline() admits across all EDF threads.  The rest
+   of the CPU is left to the priority and MLFQS classes. */
+#define EDF_UTIL_MAX 900
+
+/* Number of thread pages to put into the thread page cache at
+   boot.  Controlled by kernel command-line option
+   "-threadcache=N". */
+extern size_t thread_cache_prewarm;
+
 void thread_init (void);
 void thread_start (void);
 
@@ -169,11 +239,17 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_change_priority (struct thread *, int priority);
+
+bool thread_set_deadline (int64_t period, int64_t budget);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
+int thread_get_tickets (void);
+void thread_set_tickets (int);
 struct thread* get_id_thread(tid_t);
+bool thread_get_stats (tid_t, struct sched_stats *);
 
 #endif /* threads/thread.h */
@@ -0,0 +1,127 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A queue of work and the pool of threads that runs it. */
+struct work_queue
+  {
+    char name[16];              /* Name, for worker threads and stats. */
+    struct list items;          /* Pending struct work. */
+    struct semaphore ready;     /* Count of items in ITEMS. */
+    struct list_elem elem;      /* Element in all_queues. */
+    long long submit_cnt;       /* Number of items submitted. */
+    long long merge_cnt;        /* Submissions of already-pending work. */
+  };
+
+/* All work queues, for work_queue_print_stats(). */
+static struct list all_queues = LIST_INITIALIZER (all_queues);
+
+static thread_func worker;
+
+/* Creates a work queue named NAME served by THREAD_CNT worker
+   threads running at PRIORITY.  Panics if memory is exhausted,
+   since callers create their queues at boot. */
+struct work_queue *
+work_queue_create (const char *name, int thread_cnt, int priority)
+{
+  struct work_queue *wq;
+  int i;
+
+  ASSERT (thread_cnt > 0);
+  ASSERT (!intr_context ());
+
+  wq = malloc (sizeof *wq);
+  if (wq == NULL)
+    PANIC ("%s: out of memory for work queue", name);
+  strlcpy (wq->name, name, sizeof wq->name);
+  list_init (&wq->items);
+  sema_init (&wq->ready, 0);
+  wq->submit_cnt = wq->merge_cnt = 0;
+  list_push_back (&all_queues, &wq->elem);
+
+  for (i = 0; i < thread_cnt; i++)
+    {
+      char worker_name[16];
+      snprintf (worker_name, sizeof worker_name, "%s/%d", name, i);
+      if (thread_create (worker_name, priority, worker, wq) == TID_ERROR)
+        PANIC ("%s: cannot create worker thread", name);
+    }
+  return wq;
+}
+
+/* Initializes W to call FUNC, which may use AUX. */
+void
+work_init (struct work *w, work_func *func, void *aux)
+{
+  w->func = func;
+  w->aux = aux;
+  w->pending = false;
+}
+
+/* Queues W to run on one of WQ's worker threads.  May be called
+   from an interrupt handler.  Returns true if W was queued, false
+   if it was already pending, in which case a single run of W's
+   function will cover both submissions.  W may be resubmitted as
+   soon as its function starts running. */
+bool
+work_submit (struct work_queue *wq, struct work *w)
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  old_level = intr_disable ();
+  wq->submit_cnt++;
+  if (!w->pending)
+    {
+      w->pending = true;
+      list_push_back (&wq->items, &w->elem);
+      sema_up (&wq->ready);
+      queued = true;
+    }
+  else
+    wq->merge_cnt++;
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Worker thread body: runs work from queue WQ_ forever. */
+static void
+worker (void *wq_)
+{
+  struct work_queue *wq = wq_;
+
+  for (;;)
+    {
+      enum intr_level old_level;
+      struct work *w;
+
+      sema_down (&wq->ready);
+      old_level = intr_disable ();
+      w = list_entry (list_pop_front (&wq->items), struct work, elem);
+      w->pending = false;
+      intr_set_level (old_level);
+
+      w->func (w);
+    }
+}
+
+/* Prints statistics for each work queue. */
+void
+work_queue_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_queues); e != list_end (&all_queues);
+       e = list_next (e))
+    {
+      struct work_queue *wq = list_entry (e, struct work_queue, elem);
+      printf ("Work queue %s: %lld submitted, %lld merged\n",
+              wq->name, wq->submit_cnt, wq->merge_cnt);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/* Deferred work.
+
+   An interrupt handler must not sleep and runs with interrupts
+   off, so it should do as little as possible.  Work that can
+   wait, or that needs to sleep, can instead be packaged as a
+   struct work and submitted to a work queue.  One of the queue's
+   worker threads later runs it in an ordinary kernel thread. */
+
+struct work;
+typedef void work_func (struct work *);
+
+/* A unit of deferred work.  Usually embedded in a larger
+   structure; the work function can find that structure with
+   list_entry-style pointer arithmetic or through AUX. */
+struct work
+  {
+    struct list_elem elem;      /* Element in work queue. */
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* Data for FUNC. */
+    bool pending;               /* Queued but not yet started? */
+  };
+
+struct work_queue *work_queue_create (const char *name, int thread_cnt,
+                                      int priority);
+void work_init (struct work *, work_func *, void *aux);
+bool work_submit (struct work_queue *, struct work *);
+void work_queue_print_stats (void);
+
+#endif /* threads/workqueue.h */
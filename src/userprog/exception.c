@@ -8,10 +8,19 @@
 #include "vm/page.h"
 #include "vm/frame.h"
 #include "threads/synch.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "devices/timer.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+/* Time spent resolving the page faults that were resolved. */
+static long long page_fault_resolved_cnt;
+static int64_t page_fault_ns;
+static int64_t page_fault_max_ns;
+
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
@@ -69,6 +78,10 @@ void
 exception_print_stats (void) 
 {
   printf ("Exception: %lld page faults\n", page_fault_cnt);
+  if (page_fault_resolved_cnt > 0)
+    printf ("Exception: %lld resolved, %lld ns average, %lld ns max\n",
+            page_fault_resolved_cnt,
+            page_fault_ns / page_fault_resolved_cnt, page_fault_max_ns);
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -130,6 +143,7 @@ page_fault (struct intr_frame *f)
   bool write;        /* True: access was write, false: access was read. */
   bool user;         /* True: access by user, false: access by kernel. */
   void *fault_addr;  /* Fault address. */
+  int64_t start_ns;  /* timer_ns() on entry, for statistics. */
 
   /* Obtain faulting address, the virtual address that was
      accessed to cause the fault.  It may point to code or to
@@ -146,39 +160,75 @@ page_fault (struct intr_frame *f)
 
   /* Count page faults. */
   page_fault_cnt++;
+  start_ns = timer_ns ();
 
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  /* illegal write operation or invalid address or illegal accessing
-   * of kernel space. exit directly
-   */
-
-    
-
-  //lock_acquire (&e_lock);
-  if (!not_present || fault_addr == NULL || !is_user_vaddr (fault_addr)){
+  /* Reading a present page, a null address and a kernel address
+     are errors: exit at once.  A write to a present page may be to
+     a page shared copy-on-write after fork(), so it goes on. */
+  if ((!not_present && !write) || fault_addr == NULL || !is_user_vaddr (fault_addr)){
       //ASSERT (0);
    exit (-1); 
   }
 
+  struct thread *cur = thread_current ();
+  struct lock *vm_lock = &cur->process->vm_lock;
   void* rd_fault_addr = pg_round_down (fault_addr);
-  struct sup_pte *spte = get_addr_pte (&thread_current()->sup_page_table, rd_fault_addr);
-
-
-  if (!spte
-	  && rd_fault_addr >= PHYS_BASE - (8*(1<<20))
+  bool resolved = true;
+
+  /* The threads of a process share its page tables, so resolve one
+     fault at a time.  Another thread may have brought the page in
+     while we waited.  The kernel may also fault on a user page
+     while already holding the lock, e.g. in munmap(). */
+  bool locker = lock_held_by_current_thread (vm_lock);
+  if (!locker)
+    lock_acquire (vm_lock);
+  struct sup_pte *spte = get_addr_pte (&cur->process->sup_page_table, rd_fault_addr);
+
+  if (!not_present && pagedir_get_page (cur->pagedir, fault_addr) != NULL)
+    {
+      /* Copy the page unless another thread already has. */
+      if (spte != NULL && spte->cow)
+        resolved = cow_break (spte);
+      else
+        resolved = pagedir_is_writable (cur->pagedir, fault_addr);
+    }
+  else if (pagedir_get_page (cur->pagedir, fault_addr) != NULL)
+    ;
+  else if (!spte
+	  && (uint8_t *) rd_fault_addr >= cur->ustack_limit
+	  && (uint8_t *) rd_fault_addr < cur->ustack_top
 	  && fault_addr+32 >= f->esp)
   {
 	  grow_stack (fault_addr);
   }
   else if (spte != NULL && !spte->loaded) // if the spte exist but does not exist in the physical memory
-  {
-
-	  load_back (spte);
-  }
+	  resolved = load_back_ahead (spte);
+  else
+	  resolved = false;
+  if (!locker)
+    lock_release (vm_lock);
+  if (!resolved && !not_present)
+    exit (-1);
+
+  if (resolved)
+    {
+      int64_t ns = timer_ns () - start_ns;
+      enum intr_level old_level;
+
+      /* Faults in other threads update these too, and 64-bit
+         updates are not atomic. */
+      old_level = intr_disable ();
+      page_fault_resolved_cnt++;
+      page_fault_ns += ns;
+      if (ns > page_fault_max_ns)
+        page_fault_max_ns = ns;
+      intr_set_level (old_level);
+    }
   else {
 	  /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
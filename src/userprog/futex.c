@@ -0,0 +1,179 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/process.h"
+
+/* Futexes let user programs sleep until a word of their memory
+   changes, so that user-level locks need to enter the kernel
+   only when they are contended.
+
+   A futex is identified by an address space (page directory)
+   and a user virtual address in it.  It exists only while some
+   thread waits on it. */
+struct futex_key
+  {
+    uint32_t *pagedir;          /* Address space. */
+    const int *uaddr;           /* User virtual address. */
+  };
+
+struct futex
+  {
+    struct futex_key key;       /* Identity. */
+    struct semaphore sema;      /* Waiting threads sleep here. */
+    int waiters;                /* Threads waiting and not yet woken. */
+    int refs;                   /* Threads that have not yet left. */
+    struct hash_elem elem;      /* Element in `futexes'. */
+  };
+
+/* Futexes with waiters, and the lock that protects them.  The
+   lock also makes checking the futex word and starting to wait
+   atomic with respect to futex_wake(). */
+static struct hash futexes;
+static struct lock futex_lock;
+
+static hash_hash_func futex_hash;
+static hash_less_func futex_less;
+
+/* Initializes the futex table. */
+void
+futex_init (void) 
+{
+  hash_init (&futexes, futex_hash, futex_less, NULL);
+  lock_init (&futex_lock);
+}
+
+/* Returns the futex for KEY, or a null pointer if no thread
+   waits on it.  futex_lock must be held. */
+static struct futex *
+futex_lookup (const struct futex_key *key) 
+{
+  struct futex f;
+  struct hash_elem *e;
+
+  f.key = *key;
+  e = hash_find (&futexes, &f.elem);
+  return e != NULL ? hash_entry (e, struct futex, elem) : NULL;
+}
+
+/* If the int at UADDR in the address space with page directory
+   PAGEDIR equals VAL, sleeps until futex_wake() wakes us and
+   returns true.  Otherwise, or if memory is exhausted, returns
+   false at once.  Spurious wakeups are possible, so callers must
+   recheck their condition.  UADDR must be a valid user address
+   in the current process. */
+bool
+futex_wait (uint32_t *pagedir, const int *uaddr, int val) 
+{
+  struct futex_key key;
+  struct futex *f;
+
+  key.pagedir = pagedir;
+  key.uaddr = uaddr;
+
+  /* A process that is exiting must not start to sleep, or
+     futex_wake_all() could miss us. */
+  lock_acquire (&futex_lock);
+  if (*uaddr != val || thread_current ()->process->exit_called)
+    {
+      lock_release (&futex_lock);
+      return false;
+    }
+  f = futex_lookup (&key);
+  if (f == NULL)
+    {
+      f = malloc (sizeof *f);
+      if (f == NULL)
+        {
+          lock_release (&futex_lock);
+          return false;
+        }
+      f->key = key;
+      sema_init (&f->sema, 0);
+      f->waiters = f->refs = 0;
+      hash_insert (&futexes, &f->elem);
+    }
+  f->waiters++;
+  f->refs++;
+  lock_release (&futex_lock);
+
+  /* A wakeup that comes before we get here is not lost: it has
+     already upped the semaphore. */
+  sema_down (&f->sema);
+
+  lock_acquire (&futex_lock);
+  if (--f->refs == 0)
+    {
+      hash_delete (&futexes, &f->elem);
+      free (f);
+    }
+  lock_release (&futex_lock);
+  return true;
+}
+
+/* Wakes up to CNT threads waiting on the int at UADDR in the
+   address space with page directory PAGEDIR.  Returns the number
+   of threads woken. */
+int
+futex_wake (uint32_t *pagedir, const int *uaddr, int cnt) 
+{
+  struct futex_key key;
+  struct futex *f;
+  int woken = 0;
+
+  key.pagedir = pagedir;
+  key.uaddr = uaddr;
+
+  lock_acquire (&futex_lock);
+  f = futex_lookup (&key);
+  if (f != NULL)
+    for (; woken < cnt && f->waiters > 0; woken++)
+      {
+        f->waiters--;
+        sema_up (&f->sema);
+      }
+  lock_release (&futex_lock);
+  return woken;
+}
+
+/* Wakes every thread waiting on a futex in the address space with
+   page directory PAGEDIR, because its process is exiting. */
+void
+futex_wake_all (uint32_t *pagedir) 
+{
+  struct hash_iterator i;
+
+  lock_acquire (&futex_lock);
+  hash_first (&i, &futexes);
+  while (hash_next (&i))
+    {
+      struct futex *f = hash_entry (hash_cur (&i), struct futex, elem);
+      if (f->key.pagedir == pagedir)
+        for (; f->waiters > 0; f->waiters--)
+          sema_up (&f->sema);
+    }
+  lock_release (&futex_lock);
+}
+
+/* Returns a hash of futex E's key. */
+static unsigned
+futex_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  const struct futex *f = hash_entry (e, struct futex, elem);
+  return hash_bytes (&f->key, sizeof f->key);
+}
+
+/* Orders futexes by address space, then by user address. */
+static bool
+futex_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct futex *a = hash_entry (a_, struct futex, elem);
+  const struct futex *b = hash_entry (b_, struct futex, elem);
+
+  if (a->key.pagedir != b->key.pagedir)
+    return a->key.pagedir < b->key.pagedir;
+  return a->key.uaddr < b->key.uaddr;
+}
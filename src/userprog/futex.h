@@ -0,0 +1,12 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void futex_init (void);
+bool futex_wait (uint32_t *pagedir, const int *uaddr, int val);
+int futex_wake (uint32_t *pagedir, const int *uaddr, int cnt);
+void futex_wake_all (uint32_t *pagedir);
+
+#endif /* userprog/futex.h */
@@ -24,7 +24,7 @@ pagedir_create (void)
 }
 
 /* Destroys page directory PD, freeing all the pages it
-   references. */
+   references and dropping them from the frame table. */
 void
 pagedir_destroy (uint32_t *pd) 
 {
@@ -42,7 +42,17 @@ pagedir_destroy (uint32_t *pd)
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
           if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+            {
+              /* Eviction may unmap the page in the meantime, so
+                 look again with e_lock held. */
+              lock_acquire (&e_lock);
+              if (*pte & PTE_P)
+                {
+                  release_frame (pte_get_page (*pte), pd);
+                  *pte = 0;
+                }
+              lock_release (&e_lock);
+            }
         palloc_free_page (pt);
       }
   palloc_free_page (pd);
@@ -166,6 +176,52 @@ pagedir_clear_page (uint32_t *pd, void *upage)
     }
 }
 
+/* Returns true if the PTE for virtual page VPAGE in PD is
+   writable.  Returns false if PD contains no PTE for VPAGE. */
+bool
+pagedir_is_writable (uint32_t *pd, const void *vpage) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  return pte != NULL && (*pte & PTE_W) != 0;
+}
+
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PD. */
+void
+pagedir_set_writable (uint32_t *pd, const void *vpage, bool writable) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  if (pte != NULL) 
+    {
+      if (writable)
+        *pte |= PTE_W;
+      else 
+        *pte &= ~(uint32_t) PTE_W;
+      invalidate_pagedir (pd);
+    }
+}
+
+/* Calls FUNC for each user page present in PD, in order of
+   address, with the page's user virtual address, the kernel
+   virtual address of its frame, and AUX. */
+void
+pagedir_for_each (uint32_t *pd, pagedir_func *func, void *aux) 
+{
+  uint32_t *pde;
+
+  for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P) 
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        uint32_t *pte;
+
+        for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
+          if (*pte & PTE_P) 
+            func ((void *) (((pde - pd) << PDSHIFT) | ((pte - pt) << PTSHIFT)),
+                  pte_get_page (*pte), aux);
+      }
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
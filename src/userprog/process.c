@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "userprog/gdt.h"
+#include "userprog/futex.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
@@ -80,6 +81,7 @@ process_execute (const char *file_name)
   if(new_child != NULL){
     new_child->exit_normally = false;
     new_child->waited_before = false;
+    new_child->exited = false;
     new_child->child_id = tid;
     list_push_back (&cur->children, &new_child->elem);
   }
@@ -87,20 +89,55 @@ process_execute (const char *file_name)
   return tid;
 }
 
+/* Creates a process object for the current thread, which becomes
+   its initial thread.  Returns the process, or a null pointer if
+   memory is exhausted. */
+static struct process *
+process_create (void)
+{
+  struct thread *cur = thread_current ();
+  struct process *p = malloc (sizeof *p);
+
+  if (p == NULL)
+    return NULL;
+  p->pid = cur->tid;
+  strlcpy (p->name, cur->name, sizeof p->name);
+  p->parent_id = cur->parent_id;
+  p->pagedir = NULL;
+  hash_init (&p->sup_page_table, sup_pte_hash, sup_pte_less, NULL);
+  hash_init (&p->mmfiles, mmf_hash_func, mmf_descend, NULL);
+  p->mapid = 0;
+  p->executing_file = NULL;
+  lock_init (&p->vm_lock);
+  p->ra_next = NULL;
+  p->ra_window = 0;
+  lock_init (&p->lock);
+  p->thread_cnt = 1;
+  list_init (&p->uthreads);
+  cond_init (&p->uthread_exited);
+  p->stack_slots = 0;
+  p->exit_called = false;
+  p->exit_status = -1;
+
+  cur->process = p;
+  cur->ustack_top = PHYS_BASE;
+  cur->ustack_limit = (uint8_t *) PHYS_BASE - STACK_MAX;
+  return p;
+}
+
 /* A thread function that loads a user process and starts it
    running. */
 static void
 start_process (void *file_name_)
 {
-  char *file_name = (char*) ((struct id_passer*)file_name_)->file_name;
+  struct id_passer *passer = file_name_;
+  char *file_name = passer->file_name;
 
   struct intr_frame if_;
-  bool success;
-
+  bool success = false;
 
-  // Initialize the supplementary hash table and mmf table
-  hash_init (&thread_current ()->sup_page_table, sup_pte_hash, sup_pte_less,NULL);
-  hash_init (&thread_current ()->mmfiles, mmf_hash_func, mmf_descend,NULL);
+  thread_current ()->parent_id = passer->tid;
+  palloc_free_page (passer->free);
 
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
@@ -108,7 +145,8 @@ start_process (void *file_name_)
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
 
-  success = load (file_name, &if_.eip, &if_.esp);
+  if (process_create () != NULL)
+    success = load (file_name, &if_.eip, &if_.esp);
 
   palloc_free_page (file_name);
   free (file_name_);
@@ -144,6 +182,154 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* Start-up information for a process created by fork(). */
+struct fork_start
+  {
+    struct process *parent;     /* Process to copy. */
+    tid_t parent_tid;           /* Thread that called fork(). */
+    struct intr_frame if_;      /* Its registers at the call. */
+    uint8_t *ustack_top;        /* Its user stack region. */
+    uint8_t *ustack_limit;
+    bool success;               /* Was the copy successful? */
+    struct semaphore done;      /* Upped when the child is set up. */
+  };
+
+static thread_func start_fork NO_RETURN;
+
+/* Creates a child of the current process that is a copy of it,
+   sharing its pages copy-on-write, with a single thread that
+   returns from the system call whose registers are in F with a
+   return value of 0.  Returns the child's pid, or TID_ERROR if it
+   cannot be created. */
+tid_t
+process_fork (const struct intr_frame *f)
+{
+  struct thread *cur = thread_current ();
+  struct fork_start start;
+  struct child_info *child;
+  tid_t tid;
+
+  child = malloc (sizeof *child);
+  if (child == NULL)
+    return TID_ERROR;
+  start.parent = cur->process;
+  start.parent_tid = cur->tid;
+  start.if_ = *f;
+  start.ustack_top = cur->ustack_top;
+  start.ustack_limit = cur->ustack_limit;
+  start.success = false;
+  sema_init (&start.done, 0);
+
+  /* Record the child before it can exit and look for itself in
+     our list. */
+  lock_acquire (&cur->child_lock);
+  tid = thread_create (cur->name, PRI_DEFAULT, start_fork, &start);
+  if (tid != TID_ERROR)
+    {
+      child->exit_normally = false;
+      child->waited_before = false;
+      child->exited = false;
+      child->child_id = tid;
+      list_push_back (&cur->children, &child->elem);
+    }
+  else
+    free (child);
+  lock_release (&cur->child_lock);
+
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+  sema_down (&start.done);
+  return start.success ? tid : TID_ERROR;
+}
+
+/* Copies the parent's open files to process P. */
+static bool
+fork_files (struct process *parent, struct process *p)
+{
+  struct list_elem *e;
+  bool success = true;
+
+  rwlock_acquire_write (&file_lock);
+  for (e = list_begin (&fd_list); e != list_end (&fd_list);
+       e = list_next (e))
+    {
+      struct file_descriptor *fd = list_entry (e, struct file_descriptor,
+                                               elem);
+      struct file_descriptor *copy;
+
+      if (fd->owner != parent->pid)
+        continue;
+      copy = malloc (sizeof *copy);
+      if (copy == NULL)
+        {
+          success = false;
+          break;
+        }
+      copy->fid = fd->fid;
+      copy->owner = p->pid;
+      copy->sys_file = file_reopen (fd->sys_file);
+      lock_init (&copy->pos_lock);
+      if (copy->sys_file == NULL)
+        {
+          free (copy);
+          success = false;
+          break;
+        }
+      file_seek (copy->sys_file, file_tell (fd->sys_file));
+      list_push_front (&fd_list, &copy->elem);
+    }
+  rwlock_release_write (&file_lock);
+  return success;
+}
+
+/* A thread function that makes its thread a copy of the thread
+   that called fork(), in a copy of its process, and starts it
+   running. */
+static void
+start_fork (void *start_)
+{
+  struct fork_start *start = start_;
+  struct process *parent = start->parent;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_ = start->if_;
+  struct process *p;
+  bool success = false;
+
+  cur->parent_id = start->parent_tid;
+  p = process_create ();
+  if (p != NULL)
+    {
+      cur->ustack_top = start->ustack_top;
+      cur->ustack_limit = start->ustack_limit;
+      if (cur->ustack_top != PHYS_BASE)
+        p->stack_slots = 1u << (((uint8_t *) PHYS_BASE - STACK_MAX
+                                 - cur->ustack_top) / UTHREAD_STACK_SIZE);
+      cur->pagedir = p->pagedir = pagedir_create ();
+    }
+  if (p != NULL && p->pagedir != NULL)
+    {
+      process_activate ();
+      p->executing_file = file_reopen (parent->executing_file);
+      if (p->executing_file != NULL)
+        {
+          file_deny_write (p->executing_file);
+          success = (mmf_fork (parent, p)
+                     && fork_pages (parent, p)
+                     && fork_files (parent, p));
+        }
+    }
+
+  start->success = success;
+  sema_up (&start->done);
+  if (!success)
+    thread_exit ();
+
+  /* fork() returns 0 in the child. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -151,8 +337,7 @@ start_process (void *file_name_)
    been successfully called for the given TID, returns -1
    immediately, without waiting.
 
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   A process dies when the last of its threads exits. */
 int
 process_wait (tid_t child_tid) 
 {
@@ -164,16 +349,18 @@ process_wait (tid_t child_tid)
   struct list_elem* e;
   for (e = list_begin (&cur->children); e != list_end (&cur->children);
        e = list_next (e)){
-      child = list_entry (e, struct child_info, elem);
-      if(child->child_id == child_tid)
+      struct child_info *ci = list_entry (e, struct child_info, elem);
+      if(ci->child_id == child_tid){
+        child = ci;
         break ;
+      }
   }
 
   if(child == NULL) 
     return -1;
 
   lock_acquire (&cur->child_lock);
-  while(get_id_thread (child_tid) != NULL){
+  while(!child->exited){
     cond_wait (&cur->child_cond, &cur->child_lock);
   }
   if(child->waited_before || !child->exit_normally){
@@ -188,72 +375,325 @@ process_wait (tid_t child_tid)
 
 }
 
-/* Free the current process's resources. */
+/* One additional thread of a process, kept until joined or until
+   the process dies. */
+struct uthread
+  {
+    tid_t tid;                  /* Thread's tid. */
+    int slot;                   /* Stack slot. */
+    bool exited;                /* Has it exited? */
+    struct list_elem elem;      /* Element in process's uthreads. */
+  };
+
+/* Start-up information for a new thread of a process. */
+struct uthread_start
+  {
+    struct process *process;    /* Process to join. */
+    int slot;                   /* Stack slot to run on. */
+    void (*entry) (void);       /* User entry point. */
+    void *func;                 /* Passed in %eax. */
+    void *aux;                  /* Passed in %edx. */
+  };
+
+static thread_func start_uthread NO_RETURN;
+
+/* Starts a new thread in the current process, sharing its address
+   space and open files.  The thread begins at user address ENTRY
+   on a fresh stack, with FUNC in %eax and AUX in %edx; the user
+   library's entry stub turns these into a call.  Returns the new
+   thread's tid, or TID_ERROR on failure. */
+tid_t
+process_thread_create (void (*entry) (void), void *func, void *aux)
+{
+  struct thread *cur = thread_current ();
+  struct process *p = cur->process;
+  struct uthread_start *start;
+  struct uthread *ut;
+  tid_t tid = TID_ERROR;
+  int slot;
+
+  if (!is_user_vaddr (entry) || (void *) entry < (void *) PGSIZE
+      || p->exit_called)
+    return TID_ERROR;
+
+  start = malloc (sizeof *start);
+  ut = malloc (sizeof *ut);
+  if (start == NULL || ut == NULL)
+    goto fail;
+
+  /* Hold the lock until the new thread is on our list, so that it
+     cannot exit before we record it. */
+  lock_acquire (&p->lock);
+  for (slot = 0; slot < UTHREAD_MAX; slot++)
+    if (!(p->stack_slots & (1u << slot)))
+      break;
+  if (slot < UTHREAD_MAX)
+    {
+      start->process = p;
+      start->slot = slot;
+      start->entry = entry;
+      start->func = func;
+      start->aux = aux;
+      tid = thread_create (cur->name, PRI_DEFAULT, start_uthread, start);
+    }
+  if (tid != TID_ERROR)
+    {
+      p->stack_slots |= 1u << slot;
+      p->thread_cnt++;
+      ut->tid = tid;
+      ut->slot = slot;
+      ut->exited = false;
+      list_push_back (&p->uthreads, &ut->elem);
+    }
+  lock_release (&p->lock);
+  if (tid != TID_ERROR)
+    return tid;
+
+ fail:
+  free (start);
+  free (ut);
+  return TID_ERROR;
+}
+
+/* A thread function that enters user mode as a new thread of the
+   process in START_. */
+static void
+start_uthread (void *start_)
+{
+  struct uthread_start *start = start_;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_;
+
+  cur->process = start->process;
+  cur->pagedir = start->process->pagedir;
+  cur->ustack_top = ((uint8_t *) PHYS_BASE - STACK_MAX
+                     - start->slot * UTHREAD_STACK_SIZE);
+  cur->ustack_limit = cur->ustack_top - UTHREAD_STACK_SIZE;
+  process_activate ();
+
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = start->entry;
+  if_.esp = cur->ustack_top;
+  if_.eax = (uint32_t) start->func;
+  if_.edx = (uint32_t) start->aux;
+  free (start);
+
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Waits for thread TID of the current process to exit.  Returns
+   true if successful, false if TID is not a joinable thread of
+   this process: not created by process_thread_create(), already
+   joined, or the caller itself.  Also returns false if the process
+   is exiting, in which case the caller dies on its way back to
+   user mode. */
+bool
+process_thread_join (tid_t tid)
+{
+  struct process *p = thread_current ()->process;
+  struct list_elem *e;
+  bool success = false;
+
+  if (tid == thread_tid ())
+    return false;
+
+  lock_acquire (&p->lock);
+  for (e = list_begin (&p->uthreads); e != list_end (&p->uthreads);
+       e = list_next (e))
+    {
+      struct uthread *ut = list_entry (e, struct uthread, elem);
+      if (ut->tid == tid)
+        {
+          while (!ut->exited && !p->exit_called)
+            cond_wait (&p->uthread_exited, &p->lock);
+          if (ut->exited)
+            {
+              list_remove (&ut->elem);
+              free (ut);
+              success = true;
+            }
+          break;
+        }
+    }
+  lock_release (&p->lock);
+  return success;
+}
+
+/* Records in thread PARENT_ID's child list that process PID has
+   died, with EXIT_STATUS if EXIT_NORMALLY, and wakes up the
+   parent in case it is waiting.  Does nothing if the parent is
+   gone. */
+static void
+notify_parent (tid_t parent_id, tid_t pid, bool exit_normally,
+               int exit_status)
+{
+  struct thread *parent = get_id_thread (parent_id);
+  struct list_elem *e;
+
+  if (parent == NULL)
+    return;
+
+  lock_acquire (&parent->child_lock);
+  for (e = list_begin (&parent->children);
+       e != list_end (&parent->children); e = list_next (e))
+    {
+      struct child_info *child = list_entry (e, struct child_info, elem);
+      if (child->child_id == pid)
+        {
+          child->exit_normally = exit_normally;
+          child->exit_status = exit_status;
+          child->exited = true;
+        }
+    }
+  cond_broadcast (&parent->child_cond, &parent->child_lock);
+  lock_release (&parent->child_lock);
+}
+
+/* Frees process P's resources.  Called by its last thread, with
+   P's page directory still active. */
+static void
+process_destroy (struct process *p)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e, *next;
+
+  mmf_destroy_table (&p->mmfiles);
+
+  /* Destroy the process's page directory and switch back to the
+     kernel-only page directory.  Correct ordering here is
+     crucial.  We must set cur->pagedir to NULL before switching
+     page directories, so that a timer interrupt can't switch
+     back to the process page directory.  We must activate the
+     base page directory before destroying the process's page
+     directory, or our active page directory will be one that's
+     been freed (and cleared). */
+  cur->pagedir = NULL;
+  pagedir_activate (NULL);
+  pagedir_destroy (p->pagedir);
+
+  file_close (p->executing_file);
+  free_sup_page_table (&p->sup_page_table);
+
+  /* Close the files opened by this process. */
+  for (e = list_begin (&fd_list); e != list_end (&fd_list); e = next)
+    {
+      struct file_descriptor *fd = list_entry (e, struct file_descriptor,
+                                               elem);
+      next = list_next (e);
+      if (fd->owner == p->pid)
+        {
+          list_remove (e);
+          file_close (fd->sys_file);
+          free (fd);
+        }
+    }
+
+  for (e = list_begin (&p->uthreads); e != list_end (&p->uthreads); e = next)
+    {
+      next = list_next (e);
+      free (list_entry (e, struct uthread, elem));
+    }
+
+  if (p->exit_called && get_id_thread (p->parent_id) != NULL)
+    printf ("%s: exit(%d)\n", p->name, p->exit_status);
+  notify_parent (p->parent_id, p->pid, p->exit_called, p->exit_status);
+
+  cur->process = NULL;
+  free (p);
+}
+
+/* Free the current thread's resources, and its process's if it is
+   the last thread in it. */
 void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
-  mmf_destroy_table (&cur->mmfiles);
-  uint32_t *pd;
+  struct process *p = cur->process;
+  struct list_elem *e, *next;
+  bool last;
 
-  /* Destroy the current process's page directory and switch back
-     to the kernel-only page directory. */
-  pd = cur->pagedir;
-  if (pd != NULL) 
+  /* free the child list */
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = next)
     {
-      /* Correct ordering here is crucial.  We must set
-         cur->pagedir to NULL before switching page directories,
-         so that a timer interrupt can't switch back to the
-         process page directory.  We must activate the base page
-         directory before destroying the process's page
-         directory, or our active page directory will be one
-         that's been freed (and cleared). */
+      next = list_next (e);
+      free (list_entry (e, struct child_info, elem));
+    }
+
+  if (p == NULL)
+    {
+      /* A user process that could not get this far still has a
+         parent waiting to hear about it. */
+      notify_parent (cur->parent_id, cur->tid, false, -1);
+      return;
+    }
+
+  lock_acquire (&p->lock);
+  for (e = list_begin (&p->uthreads); e != list_end (&p->uthreads);
+       e = list_next (e))
+    {
+      struct uthread *ut = list_entry (e, struct uthread, elem);
+      if (ut->tid == cur->tid)
+        {
+          ut->exited = true;
+          p->stack_slots &= ~(1u << ut->slot);
+          cond_broadcast (&p->uthread_exited, &p->lock);
+          break;
+        }
+    }
+  last = --p->thread_cnt == 0;
+  lock_release (&p->lock);
+
+  if (last)
+    process_destroy (p);
+  else
+    {
+      /* Leave the address space to the remaining threads. */
       cur->pagedir = NULL;
       pagedir_activate (NULL);
-      pagedir_destroy (pd);
+      cur->process = NULL;
     }
+}
+
+/* Makes the current process exit with STATUS, unless another of
+   its threads already called exit().  Every thread of the process
+   then dies the next time it would return to user mode, through
+   process_check_exit(), so threads blocked in thread_join() or
+   futex_wait() are woken to let them get there. */
+void
+process_set_exit (int status)
+{
+  struct process *p = thread_current ()->process;
 
-    /* free the child list */
-    struct list_elem* e = list_begin (&cur->children);
-    struct list_elem* buffer;
-    struct child_info* ci;
-    while (e != list_tail (&cur->children)){
-      buffer = list_next (e);
-      list_remove (e);
-      ci = list_entry (e, struct child_info, elem);
-      free (ci);
-      e = buffer;
+  if (p == NULL)
+    return;
+  lock_acquire (&p->lock);
+  if (!p->exit_called)
+    {
+      p->exit_called = true;
+      p->exit_status = status;
     }
+  cond_broadcast (&p->uthread_exited, &p->lock);
+  lock_release (&p->lock);
+  futex_wake_all (p->pagedir);
+}
 
-    file_close (cur->executing_file);
-    free_sup_page_table (&cur->sup_page_table);
-    /* free the file open by this thread */
-    struct file_descriptor* fd_buffer;
-    // lock_acquire (&file_lock);
-    e = list_begin (&fd_list);
-    while ( e != list_tail (&fd_list)){
-      buffer = list_next (e);
-      
-      fd_buffer = list_entry (e, struct file_descriptor, elem);
-
-      if (fd_buffer->owner == cur->tid){
-        list_remove (e);
-        file_close (fd_buffer->sys_file);
-        free (fd_buffer);
-      }
+/* Ends the current thread if its process is exiting.  Called on
+   every return from an interrupt, system call or fault to user
+   mode. */
+void
+process_check_exit (void)
+{
+  struct process *p = thread_current ()->process;
 
-      e = buffer;
-    }
-    // lock_release (&file_lock);
-
-    /* wake up the potential waiting parent */
-    struct thread* parent = get_id_thread (cur->parent_id);
-    if(parent != NULL){
-      lock_acquire (&parent->child_lock);
-      //if(parent->load_status == 0)
-      //  parent->load_status = -1;
-      cond_signal (&parent->child_cond, &parent->child_lock);
-      lock_release (&parent->child_lock);
+  if (p != NULL && p->exit_called)
+    {
+      intr_enable ();
+      thread_exit ();
     }
 }
 
@@ -364,7 +804,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
 
   /* Allocate and activate page directory. */
-  t->pagedir = pagedir_create ();
+  t->pagedir = t->process->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
@@ -378,7 +818,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
     }
 
   file_deny_write (file);
-  t->executing_file = file;
+  t->process->executing_file = file;
 
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
@@ -542,7 +982,6 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (ofs % PGSIZE == 0);
 
 
-  file_seek (file, ofs);
   while (read_bytes > 0 || zero_bytes > 0) 
     {
       /* Calculate how to fill this page.
@@ -551,48 +990,45 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-      /* Get a page of memory. 
-      uint8_t *kpage = palloc_get_page (PAL_USER);
-      if (kpage == NULL)
-        return false;
-      
-       Load this page. 
-      if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
-        {
-          palloc_free_page (kpage);
-          return false; 
-        }
-      memset (kpage + page_read_bytes, 0, page_zero_bytes);
-
-      /* Add the page to the process's address space. 
-      if (!install_page (upage, kpage, writable)) 
-        {
-          palloc_free_page (kpage);
-          return false; 
-        }*/
-
-      //####################################
+      /* Nothing is read here: record where the page comes from
+         and let the page fault handler bring it in through
+         load_back() on first touch. */
       struct thread* cur = thread_current ();
       struct sup_pte* pte = malloc (sizeof (struct sup_pte));
 
       if (pte == NULL){
         return false;
       }
-      pte->user_vaddr = upage;
+      pte->user_vaddr = (uint32_t *) upage;
       pte->type = FILE;
       pte->file_info.file = file;
       pte->file_info.offset = ofs;
       pte->file_info.writable = writable;
       pte->file_info.read_length = page_read_bytes;
       pte->file_info.empty_length = page_zero_bytes;
+      pte->writable = writable;
       pte->loaded = false;
-
-      struct hash_elem *result = hash_insert (&cur->sup_page_table, &pte->elem);
-      //printf ("here\n");
-      /*if (result == NULL){
-        return false;
-      }*/
-      //####################################
+      pte->cow = false;
+
+      /* Segments that share a page must map it from the same
+         place in the file, as some linkers emit; the page then
+         covers both. */
+      struct hash_elem *e = hash_insert (&cur->process->sup_page_table,
+                                         &pte->elem);
+      if (e != NULL)
+        {
+          struct sup_pte *old = hash_entry (e, struct sup_pte, elem);
+          free (pte);
+          if (old->file_info.file != file || old->file_info.offset != ofs)
+            return false;
+          if (old->file_info.read_length < page_read_bytes)
+            {
+              old->file_info.read_length = page_read_bytes;
+              old->file_info.empty_length = page_zero_bytes;
+            }
+          old->file_info.writable |= writable;
+          old->writable = old->file_info.writable;
+        }
 
       /* Advance. */
       read_bytes -= page_read_bytes;
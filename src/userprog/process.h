@@ -1,6 +1,9 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <hash.h>
+#include <list.h>
+#include "threads/synch.h"
 #include "threads/thread.h"
 
 struct id_passer {
@@ -9,9 +12,57 @@ struct id_passer {
 	int tid;
 };
 
+/* Size of the initial thread's stack region, which ends at
+   PHYS_BASE. */
+#define STACK_MAX (8 * 1024 * 1024)
+
+/* Additional threads in a process.  Each live one gets a
+   UTHREAD_STACK_SIZE stack region, allocated below the initial
+   thread's.  Stacks grow on demand within their region. */
+#define UTHREAD_MAX 32
+#define UTHREAD_STACK_SIZE (1024 * 1024)
+
+/* A user process: the address space, mappings and open files
+   shared by all of its threads.  Each thread holds a reference;
+   the last thread to exit tears the process down. */
+struct process
+  {
+    tid_t pid;                          /* Tid of the initial thread. */
+    char name[16];                      /* Name, for the exit message. */
+    tid_t parent_id;                    /* Thread that exec'd us. */
+    uint32_t *pagedir;                  /* Page directory. */
+    struct hash sup_page_table;         /* Supplemental page table. */
+    struct hash mmfiles;                /* Memory-mapped files. */
+    int mapid;                          /* Next mapping id. */
+    struct file *executing_file;        /* Executable, denied writes. */
+    struct lock vm_lock;                /* Serializes changes to the
+                                           page tables above. */
+    uint8_t *ra_next;                   /* Page whose fault would continue
+                                           a sequential scan. */
+    int ra_window;                      /* Pages to read ahead on it. */
+
+    struct lock lock;                   /* Guards the members below. */
+    int thread_cnt;                     /* Live threads. */
+    struct list uthreads;               /* struct uthread, for joining. */
+    struct condition uthread_exited;    /* Signaled as uthreads exit. */
+    uint32_t stack_slots;               /* Bit N set if stack slot N
+                                           is in use. */
+    bool exit_called;                   /* Has a thread called exit()?
+                                           Then every thread dies. */
+    int exit_status;                    /* Status given to first exit(). */
+  };
+
+struct intr_frame;
+
 tid_t process_execute (const char *file_name);
+tid_t process_fork (const struct intr_frame *);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
+void process_set_exit (int status);
+void process_check_exit (void);
+
+tid_t process_thread_create (void (*entry) (void), void *func, void *aux);
+bool process_thread_join (tid_t);
 
 #endif /* userprog/process.h */
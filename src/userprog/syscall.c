@@ -1,12 +1,17 @@
 #include "userprog/syscall.h"
+#include <clock.h>
+#include <round.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
+#include "userprog/futex.h"
 #include "threads/vaddr.h"
+#include "devices/rtc.h"
 #include "devices/shutdown.h"
+#include "devices/timer.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "threads/palloc.h"
@@ -16,6 +21,10 @@
 #include "vm/page.h"
 
 static int fd_counter = 2;
+
+/* Wall-clock time at boot, in nanoseconds since the Epoch, for
+   CLOCK_REALTIME. */
+static int64_t boot_realtime_ns;
 static uint32_t *esp;
 typedef int pid_t;
 
@@ -48,38 +57,61 @@ static bool validate_user_ptr(void* ptr){
 	else return false;
 }
 
+/* Makes sure user address UADDR is present in CUR's page
+   directory, loading it or growing the stack as needed.  Returns
+   false if UADDR is not a valid address in CUR's process. */
+static bool
+fault_in (struct thread *cur, void *uaddr)
+{
+	struct process *p = cur->process;
+	bool success = true;
+
+	if (pagedir_get_page (cur->pagedir, uaddr) != NULL)
+		return true;
+
+	lock_acquire (&p->vm_lock);
+	if (pagedir_get_page (cur->pagedir, uaddr) == NULL){
+		struct sup_pte* pte_tmp = get_addr_pte (&p->sup_page_table, pg_round_down (uaddr));
+		if (pte_tmp != NULL && !pte_tmp->loaded)
+			load_back (pte_tmp);
+		else if (uaddr >= (void *) (esp-32) && pte_tmp == NULL)
+			grow_stack (uaddr);
+		else 
+			success = false;
+	}
+	lock_release (&p->vm_lock);
+	return success;
+}
+
 static void syscall_handler (struct intr_frame *);
 
 void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-  lock_init (&file_lock);
+  rwlock_init (&file_lock);
   list_init (&fd_list);
+  futex_init ();
+  boot_realtime_ns = (int64_t) rtc_get_time () * NSEC_PER_SEC - timer_ns ();
+}
+
+/* Prints file system call statistics. */
+void
+syscall_print_stats (void) 
+{
+  printf ("Syscall: file lock held by at most %d readers at once\n",
+          file_lock.max_readers);
 }
 
 void halt(void){
 	shutdown_power_off ();
 }
 
+/* Ends the process with STATUS.  The calling thread exits now and
+   the process's other threads as soon as they would next run in
+   user mode; the last one out reports the status. */
 void exit(int status){
-	struct child_info * child;
-	struct thread* cur = thread_current ();
-	struct thread* parent = get_id_thread (cur->parent_id);
-
-	if (parent != NULL){
-		printf ("%s: exit(%d)\n",cur->name, status);
-		struct list_elem* e = list_tail (&parent->children);
-		while ((e = list_prev(e)) != list_head (&parent->children)){
-			child = list_entry(e, struct child_info, elem);
-			if(cur->tid == child->child_id){
-				lock_acquire (&parent->child_lock);
-				child->exit_status = status;
-				child->exit_normally = true;
-				lock_release (&parent->child_lock);
-			}
-		}
-	}
+	process_set_exit (status);
 	thread_exit ();
 }
 
@@ -129,9 +161,9 @@ bool create (char* file_name, unsigned file_size){
 	
 	bool result = 0;
 
-	lock_acquire (&file_lock);
+	rwlock_acquire_write (&file_lock);
 	result = filesys_create (file_name, file_size);
-	lock_release (&file_lock);
+	rwlock_release_write (&file_lock);
 	return result;
 }
 
@@ -140,9 +172,9 @@ bool remove (char* file_name){
 		exit (-1);
 
 	bool result;
-	lock_acquire (&file_lock);
+	rwlock_acquire_write (&file_lock);
 	result = filesys_remove (file_name);
-	lock_release (&file_lock);
+	rwlock_release_write (&file_lock);
 	return result;
 }
 
@@ -155,19 +187,24 @@ int open (char* file_name){
 	struct file* f;
 	struct file_descriptor* fd;
 
-	lock_acquire(&file_lock);
-
+	rwlock_acquire_read (&file_lock);
 	f = filesys_open (file_name);
+	rwlock_release_read (&file_lock);
+
 	if(f != NULL){
 		fd = malloc (sizeof *fd);
-		fd->fid = fd_counter++;
 		fd->sys_file = f;
-		fd->owner = thread_current ()->tid;
+		fd->owner = thread_current ()->process->pid;
+		lock_init (&fd->pos_lock);
+
+		rwlock_acquire_write (&file_lock);
+		fd->fid = fd_counter++;
 		list_push_back (&fd_list, &fd->elem);
+		rwlock_release_write (&file_lock);
+
 		result = fd->fid;
 	}
 
-	lock_release(&file_lock);
 	return result;
 }
 
@@ -176,13 +213,13 @@ int filesize (int fid){
 	struct file* f;
 
 	int result = 0;
-	lock_acquire (&file_lock);
+	rwlock_acquire_read (&file_lock);
 	fd = get_id_fd (fid);
 	if(fd != NULL){
 		f = fd->sys_file;
 		result = file_length (f);
 	}
-	lock_release (&file_lock);
+	rwlock_release_read (&file_lock);
 	return result;
 }
 
@@ -195,15 +232,8 @@ int read (int id, void* buffer, unsigned size){
 	while (buffer_buffer != NULL){
 		if (!is_user_vaddr (buffer_buffer))
 			exit (-1);
-		if (pagedir_get_page (cur->pagedir, buffer_buffer) == NULL){
-			struct sup_pte* pte_tmp = get_addr_pte (&cur->sup_page_table, pg_round_down (buffer_buffer));
-			if (pte_tmp != NULL && !pte_tmp->loaded)
-				load_back (pte_tmp);
-			else if (buffer_buffer >= (esp-32) && pte_tmp == NULL)
-				grow_stack (buffer_buffer);
-			else 
-				exit (-1);
-		}
+		if (!fault_in (cur, buffer_buffer))
+			exit (-1);
 
 		if (buffer_size == 0)
 			break;
@@ -263,7 +293,7 @@ int read (int id, void* buffer, unsigned size){
 	struct file_descriptor* fd;
 
 
-	lock_acquire (&file_lock);
+	rwlock_acquire_read (&file_lock);
 
 	if (id == STDOUT_FILENO){
 		result = -1;
@@ -282,12 +312,17 @@ int read (int id, void* buffer, unsigned size){
 	else{
 		fd = get_id_fd (id);
 		if (fd != NULL){
+			/* The read side of file_lock lets other readers in, so
+			   the position moved by file_read() needs a lock of
+			   its own. */
+			lock_acquire (&fd->pos_lock);
 			result = file_read (fd->sys_file, buffer, size);
+			lock_release (&fd->pos_lock);
 		}
 	}
 
 
-	lock_release (&file_lock);
+	rwlock_release_read (&file_lock);
 
 	return result;
 }
@@ -302,15 +337,8 @@ write (int id, const void *buffer, unsigned size){
 	while (buffer_buffer != NULL){
 		if (!is_user_vaddr (buffer_buffer))
 			exit (-1);
-		if (pagedir_get_page (cur->pagedir, buffer_buffer) == NULL){
-			struct sup_pte* pte_tmp = get_addr_pte (&cur->sup_page_table, pg_round_down (buffer_buffer));
-			if (pte_tmp != NULL && !pte_tmp->loaded)
-				load_back (pte_tmp);
-			else if (buffer_buffer >= (esp-32) && pte_tmp == NULL)
-				grow_stack (buffer_buffer);
-			else 
-				exit (-1);
-		}
+		if (!fault_in (cur, buffer_buffer))
+			exit (-1);
 
 		if (buffer_size == 0)
 			break;
@@ -372,7 +400,7 @@ write (int id, const void *buffer, unsigned size){
 	int result = 0;
 
 
-	lock_acquire (&file_lock);
+	rwlock_acquire_write (&file_lock);
 
 	if(id == STDIN_FILENO){
 		result = 0;
@@ -388,7 +416,7 @@ write (int id, const void *buffer, unsigned size){
 		}
 	}
 
-	lock_release (&file_lock);
+	rwlock_release_write (&file_lock);
 	return result;
 }
 
@@ -396,13 +424,16 @@ void
 seek (int id, unsigned position){
 	struct file_descriptor* fd;
 
-	lock_acquire (&file_lock);
+	rwlock_acquire_read (&file_lock);
 
 	fd = get_id_fd (id);
-	if (fd != NULL)
+	if (fd != NULL){
+		lock_acquire (&fd->pos_lock);
 		file_seek (fd->sys_file, position);
+		lock_release (&fd->pos_lock);
+	}
 
-	lock_release (&file_lock);
+	rwlock_release_read (&file_lock);
 	return;
 }
 
@@ -411,13 +442,16 @@ tell (int id){
 	struct file_descriptor* fd;
 	unsigned result;
 
-	lock_acquire (&file_lock);
+	rwlock_acquire_read (&file_lock);
 
 	fd = get_id_fd (id);
-	if( fd != NULL)
+	if( fd != NULL){
+		lock_acquire (&fd->pos_lock);
 		result = file_tell (fd->sys_file);
+		lock_release (&fd->pos_lock);
+	}
 
-	lock_release (&file_lock);
+	rwlock_release_read (&file_lock);
 	return result;
 }
 
@@ -426,22 +460,22 @@ close (int id){
 	struct file_descriptor* fd;
 
 
-	lock_acquire (&file_lock);
+	rwlock_acquire_write (&file_lock);
 
 	fd = get_id_fd (id);
 
-	if (fd != NULL && fd->owner != thread_current ()->tid){
-		lock_release (&file_lock);
+	if (fd != NULL && fd->owner != thread_current ()->process->pid){
+		rwlock_release_write (&file_lock);
 		exit (-1);
 	}
 
-	if(fd != NULL && fd->owner == thread_current ()->tid){
+	if(fd != NULL && fd->owner == thread_current ()->process->pid){
 		file_close (fd->sys_file);
 		list_remove (&fd->elem);
 		free (fd);
 	}
 
-	lock_release (&file_lock);
+	rwlock_release_write (&file_lock);
 	return;
 }
 
@@ -465,14 +499,20 @@ mmap (int fd, void *addr)
 	for(; offset < f_len; offset += PGSIZE)
 	{
 		void *address = addr + offset;
-		if(get_addr_pte (&thread_current ()->sup_page_table, address)
+		if(get_addr_pte (&thread_current ()->process->sup_page_table, address)
 		|| pagedir_get_page (thread_current ()->pagedir, address)) return -1;
 	}
 	
-	lock_acquire (&file_lock);
+	rwlock_acquire_read (&file_lock);
 	struct file * f_ = file_reopen (file_des->sys_file);
-	lock_release (&file_lock);
-	return mmf_insert (f_, addr, f_len);
+	rwlock_release_read (&file_lock);
+
+	struct process *p = thread_current ()->process;
+	int mapid;
+	lock_acquire (&p->vm_lock);
+	mapid = mmf_insert (f_, addr, f_len);
+	lock_release (&p->vm_lock);
+	return mapid;
 }
 
 void
@@ -481,13 +521,142 @@ munmap(int mapping)
 	struct mmfile_entry mmf;
 	mmf.mapid = mapping;
 	// delete in the mmfile table
-	struct hash_elem* e = hash_delete (&thread_current ()->mmfiles, &mmf.elem);
+	struct process *p = thread_current ()->process;
+	lock_acquire (&p->vm_lock);
+	struct hash_elem* e = hash_delete (&p->mmfiles, &mmf.elem);
 	if(e != NULL)
 	{
 		struct mmfile_entry *mmf_ = hash_entry (e, struct mmfile_entry, elem);
 		// iteratively delete the suppl_page_table entry
 		mmf_free_entry (mmf_);
 	}
+	lock_release (&p->vm_lock);
+}
+
+/* Copies the scheduler statistics of process PID, or of the
+   caller if PID is -1, to user buffer STATS. */
+static bool
+sys_schedstat (pid_t pid, struct sched_stats *stats)
+{
+	struct sched_stats s;
+
+	if (!validate_user_ptr (stats)
+	    || !validate_user_ptr ((uint8_t *) stats + sizeof *stats - 1))
+		exit (-1);
+
+	if (pid == -1)
+		pid = thread_current ()->tid;
+	if (!thread_get_stats (pid, &s))
+		return false;
+	*stats = s;
+	return true;
+}
+
+/* Returns true if UADDR is a word-aligned user address that is
+   mapped or can be paged in, false otherwise. */
+static bool
+validate_user_word (const int *uaddr)
+{
+	struct thread *cur = thread_current ();
+
+	if (uaddr == NULL || !is_user_vaddr (uaddr)
+	    || (uintptr_t) uaddr % sizeof *uaddr != 0)
+		return false;
+	return (pagedir_get_page (cur->pagedir, uaddr) != NULL
+	        || get_addr_pte (&cur->process->sup_page_table,
+	                         pg_round_down (uaddr)) != NULL);
+}
+
+/* Sleeps until woken by futex_wake() on UADDR, unless *UADDR
+   differs from VAL. */
+static bool
+sys_futex_wait (const int *uaddr, int val)
+{
+	if (!validate_user_word (uaddr))
+		exit (-1);
+	return futex_wait (thread_current ()->pagedir, uaddr, val);
+}
+
+/* Wakes up to CNT threads sleeping on UADDR. */
+static int
+sys_futex_wake (const int *uaddr, int cnt)
+{
+	if (!validate_user_word (uaddr))
+		exit (-1);
+	return futex_wake (thread_current ()->pagedir, uaddr, cnt);
+}
+
+/* Starts a thread in the calling process.  It begins at user
+   address ENTRY with FUNC and AUX in registers. */
+static tid_t
+sys_thread_create (void (*entry) (void), void *func, void *aux)
+{
+	return process_thread_create (entry, func, aux);
+}
+
+/* Waits for thread TID of the calling process to exit. */
+static bool
+sys_thread_join (tid_t tid)
+{
+	return process_thread_join (tid);
+}
+
+/* Ends the calling thread.  The process lives on until its last
+   thread exits. */
+static void
+sys_thread_exit (void)
+{
+	thread_exit ();
+}
+
+/* Puts the calling thread in the EDF class with the given period
+   and budget in milliseconds, each rounded up to whole timer
+   ticks.  A period of 0 leaves the class. */
+static bool
+sys_set_deadline (int period_ms, int budget_ms)
+{
+	if (period_ms < 0 || budget_ms < 0)
+		return false;
+	return thread_set_deadline (
+	    DIV_ROUND_UP ((int64_t) period_ms * TIMER_FREQ, 1000),
+	    DIV_ROUND_UP ((int64_t) budget_ms * TIMER_FREQ, 1000));
+}
+
+/* Stores the time of clock CLOCK in *TS.  Returns 0 if
+   successful, -1 if CLOCK is not a valid clock. */
+static int
+sys_clock_gettime (clockid_t clock, struct timespec *ts)
+{
+	struct thread *cur = thread_current ();
+	int64_t ns;
+
+	/* TS may span two pages, either of which may not be loaded
+	   yet. */
+	if (!is_user_vaddr ((uint8_t *) ts + sizeof *ts - 1)
+	    || !fault_in (cur, ts)
+	    || !fault_in (cur, (uint8_t *) ts + sizeof *ts - 1))
+		exit (-1);
+
+	if (clock == CLOCK_MONOTONIC)
+		ns = timer_ns ();
+	else if (clock == CLOCK_REALTIME)
+		ns = boot_realtime_ns + timer_ns ();
+	else
+		return -1;
+	ts->tv_sec = ns / NSEC_PER_SEC;
+	ts->tv_nsec = ns % NSEC_PER_SEC;
+	return 0;
+}
+
+/* Sets the calling thread's tickets, its share of the CPU under
+   the stride scheduler. */
+static bool
+sys_set_tickets (int tickets)
+{
+	if (tickets < TICKETS_MIN || tickets > TICKETS_MAX)
+		return false;
+	thread_set_tickets (tickets);
+	return true;
 }
 
 static void
@@ -554,6 +723,41 @@ syscall_handler (struct intr_frame *f UNUSED)
 		 	f->eax = mmap (*(stack_ptr + 4), (void *)*(stack_ptr + 5));
 		 case SYS_MUNMAP:
 		 	munmap (*(stack_ptr + 1));
+		 	break;
+		case SYS_SCHEDSTAT:
+		  f->eax = sys_schedstat (*(stack_ptr + 4),
+		                          (struct sched_stats *) *(stack_ptr + 5));
+		  break;
+		case SYS_FUTEX_WAIT:
+		  f->eax = sys_futex_wait ((int *) *(stack_ptr + 4), *(stack_ptr + 5));
+		  break;
+		case SYS_FUTEX_WAKE:
+		  f->eax = sys_futex_wake ((int *) *(stack_ptr + 4), *(stack_ptr + 5));
+		  break;
+		case SYS_THREAD_CREATE:
+		  f->eax = sys_thread_create ((void (*) (void)) *(stack_ptr + 5),
+		                              (void *) *(stack_ptr + 6),
+		                              (void *) *(stack_ptr + 7));
+		  break;
+		case SYS_THREAD_JOIN:
+		  f->eax = sys_thread_join (*(stack_ptr + 1));
+		  break;
+		case SYS_THREAD_EXIT:
+		  sys_thread_exit ();
+		  break;
+		case SYS_SET_DEADLINE:
+		  f->eax = sys_set_deadline (*(stack_ptr + 4), *(stack_ptr + 5));
+		  break;
+		case SYS_SET_TICKETS:
+		  f->eax = sys_set_tickets (*(stack_ptr + 1));
+		  break;
+		case SYS_CLOCK_GETTIME:
+		  f->eax = sys_clock_gettime (*(stack_ptr + 4),
+		                              (struct timespec *) *(stack_ptr + 5));
+		  break;
+		case SYS_FORK:
+		  f->eax = process_fork (f);
+		  break;
   	}
   }
 }
@@ -1,17 +1,23 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <debug.h>
 #include "lib/kernel/list.h"
+#include "threads/synch.h"
 #include "vm/mmfile.h"
 
 struct file_descriptor{
 	int fid;
 	int owner;
 	struct file* sys_file;
+	struct lock pos_lock;	/* Guards sys_file's position, which the
+				   threads of a process share. */
 	struct list_elem elem;
 };
 
 void syscall_init (void);
+void syscall_print_stats (void);
+void exit (int status) NO_RETURN;
 // struct lock file_lock;
 /* be the struct keep track of all the opened file */
 struct list fd_list;
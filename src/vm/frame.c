@@ -1,4 +1,5 @@
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/malloc.h"
@@ -8,29 +9,63 @@
 #include "userprog/pagedir.h"
 #include "vm/page.h"
 #include "threads/pte.h"
+#include "threads/vaddr.h"
 #include "vm/swap.h"
+#include "vm/share.h"
 
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "devices/timer.h"
 
 #include "vm/frame.h"
 
+/* Frame table: one entry per page of the user pool, indexed by
+   the page's offset from the start of the pool, so that the
+   entry for a page is found in constant time.  FRAME_LOCK guards
+   the entries' in_use and fixed members. */
+static struct frame_table_entry *frame_table;
+static uint8_t *frame_base;     /* First page of the user pool. */
+static size_t frame_cnt;        /* Number of pages in the user pool. */
 static struct lock frame_lock;
 
+/* Eviction clock.  CLOCK_HAND is the hand that evicts; with two
+   hands, the other runs CLOCK_SPREAD frames ahead of it. */
+int frame_clock_hands = 2;
+static size_t clock_hand;
+static size_t clock_spread;
+
+/* Eviction statistics. */
+static long long evict_cnt;      /* Victims picked. */
+static long long evict_scan_cnt; /* Frames the hands passed. */
+static int64_t evict_ns;         /* Time spent picking victims. */
+
 //fuck static struct lock eviction_lock;
+static struct frame_table_entry *frame_entry (void *);
 static struct frame_table_entry *pick_victim (void);
+static bool lock_victim (struct frame_table_entry *, bool *took);
 static bool bookkeep_eviction (struct frame_table_entry *);
 
 
 void
 frame_init ()
 {
-  list_init (&frame_table);
+  size_t table_pages;
+  size_t i;
+
+  frame_base = palloc_user_pool (&frame_cnt);
+  table_pages = DIV_ROUND_UP (frame_cnt * sizeof *frame_table, PGSIZE);
+  frame_table = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, table_pages);
+  for (i = 0; i < frame_cnt; i++)
+    frame_table[i].frame = (uint32_t *) (frame_base + i * PGSIZE);
+  clock_spread = frame_cnt / 4 > 0 ? frame_cnt / 4 : 1;
+
   lock_init (&frame_lock);
   lock_init (&e_lock);
 }
 
-/* allocate a page from USER_POOL, and add an entry to frame table */
+/* allocate a page from USER_POOL, and add an entry to frame table.
+   If the pool is exhausted, a frame is evicted instead; with
+   PAL_ZERO it is zeroed like a fresh page would be. */
 void *
 allocate_frame (enum palloc_flags flags)
 {
@@ -44,18 +79,21 @@ allocate_frame (enum palloc_flags flags)
   }
 
   if (frame != NULL){
-    struct frame_table_entry *fte = malloc(sizeof(struct frame_table_entry));
-    fte->owner = thread_current();
-    fte->frame = frame;
-    fte->fixed = false;
-    // fte->fixed = true;
+    struct frame_table_entry *fte = frame_entry (frame);
     lock_acquire (&frame_lock);
-    list_push_back (&frame_table, &fte->elem);
+    fte->in_use = true;
+    fte->owner = thread_current ()->process;
+    fte->pg_info = NULL;
+    fte->vaddr = NULL;
+    fte->fixed = false;
+    fte->shared = NULL;
     lock_release (&frame_lock);
   }
   else{
     frame = evict_frame ();
     ASSERT(frame != NULL);
+    if (flags & PAL_ZERO)
+      memset (frame, 0, PGSIZE);
   }
   return frame;
 }
@@ -63,24 +101,40 @@ allocate_frame (enum palloc_flags flags)
 void
 free_frame (void *frame)
 {
-  struct frame_table_entry *fte;
-  struct list_elem *e;
-
-  lock_acquire(&frame_lock);
-  for(e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e)){
-    fte = list_entry (e, struct frame_table_entry, elem);
-    if(fte->frame == frame){
-      list_remove(e);
-      free(fte);
-      break;
-    }
+  struct frame_table_entry *fte = frame_entry (frame);
+
+  if (fte != NULL){
+    lock_acquire (&frame_lock);
+    fte->in_use = false;
+    fte->vaddr = NULL;
+    lock_release (&frame_lock);
   }
-  lock_release(&frame_lock);
   palloc_free_page (frame);
 }
 
+/* Drops page directory PD's mapping of FRAME, freeing FRAME
+   unless it holds a shared page that other processes still map.
+   Must be called with e_lock held, so that FRAME is not evicted
+   meanwhile. */
+void
+release_frame (void *frame, uint32_t *pd)
+{
+  struct frame_table_entry *fte = get_frame (frame);
+
+  ASSERT (lock_held_by_current_thread (&e_lock));
+  if (fte != NULL && fte->shared != NULL && !share_unmap (fte, pd))
+    return;
+  free_frame (frame);
+}
+
+/* evict a frame and save its content for later swap in.
 
-/* evict a frame and save its content for later swap in */
+   Eviction changes the page tables of the processes that map the
+   victim, so it holds their vm_locks.  Those are taken before
+   e_lock, so here they can only be tried for, and the clock
+   passes over frames of processes that are busy with their page
+   tables.  If every frame is busy, one of those processes may be
+   waiting for e_lock, so let go of it for a moment. */
 void *
 evict_frame ()
 {
@@ -88,16 +142,32 @@ evict_frame ()
   if (!locker)
   lock_acquire (&e_lock);
   bool result;
+  bool took = false;
   struct frame_table_entry *fte;
   // struct thread *t = thread_current ();
 
   // enum intr_level old_level = intr_disable ();
-  fte = pick_victim ();
-  ASSERT (fte != NULL);
+  for (;;)
+    {
+      fte = pick_victim ();
+      if (fte != NULL && lock_victim (fte, &took))
+        break;
+      if (fte == NULL)
+        {
+          ASSERT (!locker);
+          lock_release (&e_lock);
+          timer_sleep (1);
+          lock_acquire (&e_lock);
+        }
+    }
   result = bookkeep_eviction (fte);
   ASSERT (result);
+  if (took)
+    lock_release (&fte->owner->vm_lock);
 
-  fte->owner = thread_current ();
+  fte->owner = thread_current ()->process;
+  fte->pg_info = NULL;
+  fte->vaddr = NULL;
 
   // intr_set_level (old_level);
   if (!locker)
@@ -106,160 +176,231 @@ evict_frame ()
   return fte->frame;
 }
 
-/* select a frame to evict */
+/* Returns true if FTE holds a mapped page that may be evicted.
+   Must be called with frame_lock held. */
+static bool
+evictable (struct frame_table_entry *fte)
+{
+  if (!fte->in_use || fte->fixed || fte->vaddr == NULL)
+    return false;
+  if (fte->shared != NULL)
+    return share_idle (fte);
+  return frame_process_idle (fte->owner);
+}
+
+/* Returns true if no thread but the current one holds process
+   P's vm_lock, so that eviction is likely to get it. */
+bool
+frame_process_idle (struct process *p)
+{
+  return p->vm_lock.holder == NULL
+         || lock_held_by_current_thread (&p->vm_lock);
+}
+
+/* Tries to take process P's vm_lock for eviction.  Returns true
+   if the current thread holds it afterward.  Sets *TOOK to true
+   if it was taken here, in which case the caller must release
+   it. */
+bool
+frame_lock_process (struct process *p, bool *took)
+{
+  *took = false;
+  if (lock_held_by_current_thread (&p->vm_lock))
+    return true;
+  *took = lock_try_acquire (&p->vm_lock);
+  return *took;
+}
+
+/* Takes the vm_locks of the processes that map FTE, the chosen
+   victim.  Returns false, holding none of them, if one is busy.
+   For a private page, sets *TOOK as frame_lock_process() does;
+   share_evict() releases the locks taken for a shared page. */
+static bool
+lock_victim (struct frame_table_entry *fte, bool *took)
+{
+  *took = false;
+  if (fte->shared != NULL)
+    return share_lock (fte);
+  return frame_lock_process (fte->owner, took);
+}
+
+/* Returns true if FTE's page has been accessed since its
+   accessed bit was last cleared, and clears the bit if CLEAR is
+   true.  A shared page counts as accessed if any of the
+   processes mapping it has accessed it. */
+static bool
+test_accessed (struct frame_table_entry *fte, bool clear)
+{
+  uint32_t *pd = fte->owner->pagedir;
+
+  if (fte->shared != NULL)
+    return share_accessed (fte, clear);
+  if (!pagedir_is_accessed (pd, fte->vaddr))
+    return false;
+  if (clear)
+    pagedir_set_accessed (pd, fte->vaddr, false);
+  return true;
+}
+
+/* Selects a frame to evict, or returns a null pointer if every
+   frame is free, pinned or not yet mapped.  Must be called with
+   e_lock held.
+
+   With one hand, this is the classic clock: the hand clears the
+   accessed bit of each frame it passes and stops at the first
+   frame whose bit was already clear.  With two, the front hand
+   runs clock_spread frames ahead of the back hand and clears
+   accessed bits, and the back hand evicts the first frame that
+   has not been accessed since the front hand passed it.  Either
+   way the hands persist across calls, so every frame gets the
+   same scrutiny, and the scan is bounded: if every evictable
+   frame keeps being accessed, the first one the back hand saw is
+   taken.  Frames that are not evictable are passed over without
+   touching their accessed bits, as are frames of processes that
+   another thread is changing the page tables of.  The scan holds
+   frame_lock, so that no frame is pinned or freed while the
+   hands look at it. */
 static struct frame_table_entry *
 pick_victim ()
 {
-  struct frame_table_entry *fte = NULL;
-  struct frame_table_entry *victim = NULL;
-  struct thread *t;
-  struct list_elem *e = list_begin(&frame_table);
-  struct list_elem *next;
-
-  int round_cnt = 1;
-
-  // Clock approximate LRU Algorithm
-  while(true){
-    (e == list_back(&frame_table))?(next = list_begin(&frame_table)):(next = list_next (e));
-    fte = list_entry (e, struct frame_table_entry, elem);
-    t = fte->owner;
-    if (fte->fixed)
-      continue;
-    if(!pagedir_is_accessed (t->pagedir, fte->vaddr)/* && fte->fixed == false*/){
-      victim = fte;
-      break;
-    }
-    else{
-      pagedir_set_accessed (t->pagedir, fte->vaddr, false);
-    }
-    e = next;
-    if(e == list_begin(&frame_table)){
-      round_cnt++;
-      if(round_cnt > 3)
-        return NULL; // Cannot pick a victim
+  struct frame_table_entry *fallback = NULL;
+  size_t step, max_steps;
+  int64_t start = timer_ns ();
+
+  if (frame_cnt == 0)
+    return NULL;
+
+  lock_acquire (&frame_lock);
+  max_steps = 2 * frame_cnt + clock_spread;
+  for (step = 0; step < max_steps; step++)
+    {
+      struct frame_table_entry *back = &frame_table[clock_hand];
+
+      if (frame_clock_hands == 2)
+        {
+          struct frame_table_entry *front
+            = &frame_table[(clock_hand + clock_spread) % frame_cnt];
+          if (evictable (front))
+            test_accessed (front, true);
+        }
+      clock_hand = (clock_hand + 1) % frame_cnt;
+      evict_scan_cnt++;
+
+      if (!evictable (back))
+        continue;
+      if (fallback == NULL)
+        fallback = back;
+      if (!test_accessed (back, frame_clock_hands == 1))
+        {
+          fallback = back;
+          break;
+        }
     }
-  }
-  return victim;
+  lock_release (&frame_lock);
+
+  evict_cnt++;
+  evict_ns += timer_ns () - start;
+  return fallback;
+}
+
+/* Prints eviction statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Frame: %lld evictions, %lld frames scanned, %lld ns deciding "
+          "(%d-handed clock)\n",
+          evict_cnt, evict_scan_cnt, evict_ns, frame_clock_hands);
 }
 
-/* save evicted frame's content for later swap in */
+/* save evicted frame's content for later swap in.  The frame is
+   not cleared here: allocate_frame() zeroes it if asked for
+   PAL_ZERO, and every other caller fills it entirely. */
 static bool
 bookkeep_eviction (struct frame_table_entry *fte)
-{  struct thread *t = fte->owner;
-  struct sup_pte *spte = get_addr_pte (&t->sup_page_table, fte->vaddr);
+{  struct process *p = fte->owner;
+  struct sup_pte *spte = get_addr_pte (&p->sup_page_table, fte->vaddr);
   size_t swap_idx;
 
+  if (fte->shared != NULL)
+    return share_evict (fte);
+
   if (!spte) {
       spte = malloc(sizeof(struct sup_pte));
       spte->type = SWAP;
       spte->user_vaddr = fte->vaddr;
-      if (!insert_sup_pte (&t->sup_page_table, spte)){
+      spte->cow = false;
+      if (!insert_sup_pte (&p->sup_page_table, spte)){
         return false;
       }
   }
 
-  if (pagedir_is_dirty (t->pagedir, spte->user_vaddr) && spte->type == MMF)
+  if (pagedir_is_dirty (p->pagedir, spte->user_vaddr) && spte->type == MMF)
 	  write_mmf_back (spte);
-  else if (pagedir_is_dirty (t->pagedir, spte->user_vaddr) || spte->type != FILE){
+  else if (pagedir_is_dirty (p->pagedir, spte->user_vaddr) || spte->type != FILE){
       spte->type = spte->type|SWAP;
-      swap_idx = swap_out (spte->user_vaddr);
+      swap_idx = swap_out (fte->frame);
       if(swap_idx == SIZE_MAX) {
         return false;
       }
       spte->swap_index = swap_idx;
 
   }
-  memset (fte->frame, 0, PGSIZE);
 
   spte->loaded = false;
-  spte->writable = *(fte->pg_info) & PTE_W;
+  if (!spte->cow)
+    spte->writable = pagedir_is_writable (p->pagedir, spte->user_vaddr);
 
-  pagedir_clear_page (t->pagedir, spte->user_vaddr);
+  pagedir_clear_page (p->pagedir, spte->user_vaddr);
 
   return true;
 }
 
-/* Get the vm_frame struct, whose frame contribute equals the given frame, from
- * the frame list frame_table. */
+/* Returns the frame table entry for FRAME, a page of the user
+   pool, or a null pointer if FRAME is not in the user pool. */
+static struct frame_table_entry *
+frame_entry (void *frame)
+{
+  if ((uint8_t *) frame < frame_base
+      || (size_t) (pg_no (frame) - pg_no (frame_base)) >= frame_cnt)
+    return NULL;
+  return &frame_table[pg_no (frame) - pg_no (frame_base)];
+}
+
+/* Returns the frame table entry for FRAME if FRAME was allocated
+   with allocate_frame() and not yet freed, otherwise a null
+   pointer. */
 struct frame_table_entry *
 get_frame (void *frame)
 {
+  struct frame_table_entry *fte = frame_entry (frame);
 
-  struct frame_table_entry *fte;
-  struct list_elem *e = list_begin (&frame_table);
-
-  lock_acquire (&frame_lock);
-  for (; e != list_end(&frame_table); e = list_next (e)){
-      fte = list_entry (e, struct frame_table_entry, elem);
-      if (fte->frame == frame){
-        lock_release (&frame_lock);
-        return fte;
-      }
-  }  
-  lock_release (&frame_lock);
-  return NULL;
+  return fte != NULL && fte->in_use ? fte : NULL;
 }
 
+/* Returns the frame table entry for the page mapped at user
+   address ADDR in the current process. */
 static struct frame_table_entry *
-get_vaddr_frame (void *frame)
+get_vaddr_frame (void *addr)
 {
+  void *frame = pagedir_get_page (thread_current ()->pagedir, addr);
 
-  struct frame_table_entry *fte;
-  struct list_elem *e = list_begin (&frame_table);
-
-  lock_acquire (&frame_lock);
-  for (; e != list_end(&frame_table); e = list_next (e)){
-      fte = list_entry (e, struct frame_table_entry, elem);
-      struct thread* cur = thread_current ();
-      if (fte->vaddr == frame && cur == fte->owner){
-        lock_release (&frame_lock);
-        return fte;
-      }
-  }  
-  lock_release (&frame_lock);
-  return NULL;
+  return frame != NULL ? get_frame (pg_round_down (frame)) : NULL;
 }
 
 void 
 fix_frame (void* addr){
-  lock_acquire (&frame_lock);
   struct frame_table_entry* fte = get_vaddr_frame(addr);
   ASSERT (fte);
+  lock_acquire (&frame_lock);
   fte->fixed = true;
   lock_release (&frame_lock);
 }
 
 void 
 unfix_frame (void* addr){
-  lock_acquire (&frame_lock);
   struct frame_table_entry* fte = get_vaddr_frame(addr);
   ASSERT (fte);
+  lock_acquire (&frame_lock);
   fte->fixed = false;
   lock_release (&frame_lock);
 }
-
-// void
-// fix_frame (void* frame)
-// {
-//   lock_acquire(&frame_lock);
-//   struct frame_table_entry fte;
-//   fte.vaddr = frame;
-//   struct hash_elem *h = hash_find (&frame_table, &fte.elem);
-//   ASSERT (h);
-//   struct frame_table_entry *fte_ptr = hash_entry(h, struct frame_table_entry, elem);
-//   fte_ptr->fixed = true;
-//   lock_release(&frame_lock);
-// }
-
-// void
-// unfix_frame (void* frame)
-// {
-//   lock_acquire(&frame_lock);
-//   struct frame_table_entry fte;
-//   fte.vaddr = frame;
-//   struct hash_elem *h = hash_find (&frame_table, &fte.elem);
-//   ASSERT (h);
-//   struct frame_table_entry *fte_ptr = hash_entry(h, struct frame_table_entry, elem);
-//   fte_ptr->fixed = true;
-//   lock_release(&frame_lock);
-// }
\ No newline at end of file
@@ -1,27 +1,30 @@
 #ifndef FRAME_H
 #define FRAME_H
 
+#include "threads/palloc.h"
 #include "threads/thread.h"
+#include "userprog/process.h"
 
 struct lock e_lock;
 
+/* A page of the user pool.  The frame table holds one entry for
+   every page in the pool, whether or not it is in use. */
 struct frame_table_entry {
-  uint32_t *frame;
-  struct thread* owner;
-  uint32_t *pg_info;
-  void* vaddr;
-  bool fixed;
-  // bool fixed;
-  struct list_elem elem;
+  uint32_t *frame;              /* Kernel virtual address of the page. */
+  bool in_use;                  /* Allocated by allocate_frame()? */
+  struct process* owner;
+  uint32_t *pg_info;            /* Owner's PTE mapping the page. */
+  void* vaddr;                  /* User address mapped to the page. */
+  bool fixed;                   /* Pinned, i.e. not to be evicted? */
+  struct shared_page *shared;   /* Shared text page, or null. */
 };
 
-struct list frame_table;
-
 /* Wrap up palloc_get_page () and palloc_free_page ()
 ** When the page allocation happens, automatically modify the frame table*/
 void frame_init (); // Initialize the data structure, lock etc.
 void *allocate_frame (enum palloc_flags flags); // Wrap up palloc_get_page ()
 void free_frame (void *page); // Wrap up palloc_free_page ()
+void release_frame (void *page, uint32_t *pd);
 struct frame_table_entry * get_frame (void *frame);
 // void fix_frame (void* frame);
 // void unfix_frame (void* frame);
@@ -35,4 +38,12 @@ void *evict_frame (void);
 void fix_frame (void* addr);
 void unfix_frame (void* addr);
 
+bool frame_process_idle (struct process *);
+bool frame_lock_process (struct process *, bool *took);
+
+/* Number of hands of the eviction clock, 1 or 2.  Controlled by
+   kernel command-line option "-clock=N". */
+extern int frame_clock_hands;
+void frame_print_stats (void);
+
 #endif
@@ -22,8 +22,8 @@ mmf_insert (struct file* f, void *addr, int length)
     //printf ("one\n");
     return -1;
   }
-  mmf->mapid = cur->mapid;
-  cur->mapid++;
+  mmf->mapid = cur->process->mapid;
+  cur->process->mapid++;
   mmf->mapped_file = f;
   mmf->addr = addr;
 
@@ -53,7 +53,9 @@ mmf_insert (struct file* f, void *addr, int length)
     pte->file_info.offset=offset;
     pte->file_info.read_length = chunk;
     pte->loaded = false;
-    if (hash_insert(&cur->sup_page_table, &pte->elem)) {
+    pte->writable = true;
+    pte->cow = false;
+    if (hash_insert(&cur->process->sup_page_table, &pte->elem)) {
       //printf ("three\n");
       return -1;
     }
@@ -63,7 +65,7 @@ mmf_insert (struct file* f, void *addr, int length)
     addr += PGSIZE;
   }
   mmf->pg_num = pg_num;
-  if(hash_insert (&cur->mmfiles, &mmf->elem)) {
+  if(hash_insert (&cur->process->mmfiles, &mmf->elem)) {
     //printf ("four\n");
     return -1;
   }
@@ -82,26 +84,26 @@ void mmf_free_entry (struct mmfile_entry *mmf)
   while (pg_num > 0)
   {
     spte.user_vaddr = mmf->addr + offset;
-    e = hash_delete (&cur->sup_page_table, &spte.elem);
+    e = hash_delete (&cur->process->sup_page_table, &spte.elem);
     if(e != NULL)
     {
       spte_p = hash_entry (e, struct sup_pte, elem);
       if (pagedir_is_dirty (cur->pagedir, spte_p->user_vaddr) && spte_p->loaded)
       {
-        lock_acquire (&file_lock);
+        rwlock_acquire_write (&file_lock);
         file_seek (spte_p->file_info.file, spte_p->file_info.offset);
         file_write (spte_p->file_info.file, spte_p->user_vaddr, spte_p->file_info.read_length);
-        lock_release (&file_lock);
+        rwlock_release_write (&file_lock);
       }
       free (spte_p);
     }
     offset += PGSIZE;
     pg_num--;
   }
-  lock_acquire (&file_lock);
+  rwlock_acquire_write (&file_lock);
   file_close (mmf->mapped_file);
   free (mmf);
-  lock_release (&file_lock);
+  rwlock_release_write (&file_lock);
 }
 
 void mmf_destroy_table (struct hash *mmfiles)
@@ -115,3 +117,48 @@ mmf_hash_destroy_func (struct hash_elem *e, void *aux UNUSED)
   struct mmfile_entry *mmf = hash_entry (e, struct mmfile_entry, elem);
   mmf_free_entry (mmf);
 }
+
+/* Gives CHILD the same mappings as PARENT, each with its own
+   handle on the mapped file.  The pages themselves are copied by
+   fork_pages().  Returns true if successful. */
+bool
+mmf_fork (struct process *parent, struct process *child)
+{
+  struct hash_iterator i;
+
+  child->mapid = parent->mapid;
+  hash_first (&i, &parent->mmfiles);
+  while (hash_next (&i))
+  {
+    struct mmfile_entry *mmf = hash_entry (hash_cur (&i), struct mmfile_entry, elem);
+    struct mmfile_entry *copy = malloc (sizeof *copy);
+    if (copy == NULL)
+      return false;
+    *copy = *mmf;
+    copy->mapped_file = file_reopen (mmf->mapped_file);
+    if (copy->mapped_file == NULL) {
+      free (copy);
+      return false;
+    }
+    hash_insert (&child->mmfiles, &copy->elem);
+  }
+  return true;
+}
+
+/* Returns the file mapped at user address ADDR in MMFILES, or a
+   null pointer if none is. */
+struct file *
+mmf_get_file (struct hash *mmfiles, void *addr)
+{
+  struct hash_iterator i;
+
+  hash_first (&i, mmfiles);
+  while (hash_next (&i))
+  {
+    struct mmfile_entry *mmf = hash_entry (hash_cur (&i), struct mmfile_entry, elem);
+    if ((uint8_t *) addr >= (uint8_t *) mmf->addr
+        && (uint8_t *) addr < (uint8_t *) mmf->addr + mmf->pg_num * PGSIZE)
+      return mmf->mapped_file;
+  }
+  return NULL;
+}
@@ -26,7 +26,9 @@
 #include "userprog/syscall.h"
 #include "vm/frame.h"
 
-struct lock file_lock;
+/* Guards the file system layer and fd_list.  Calls that only
+   read files or look up descriptors hold it for reading. */
+struct rwlock file_lock;
 
 struct mmfile_entry
 {
@@ -49,4 +51,10 @@ void mmf_free_entry (struct mmfile_entry* mmf);
 // Destroy the hash table
 void mmf_destroy_table (struct hash *mmfiles);
 
+// Copy a process's mappings into a forked child
+bool mmf_fork (struct process *parent, struct process *child);
+
+// File mapped at a user address
+struct file *mmf_get_file (struct hash *mmfiles, void *addr);
+
 #endif
\ No newline at end of file
@@ -5,10 +5,13 @@
 #include "userprog/pagedir.h"
 #include "threads/palloc.h"
 #include "filesys/file.h"
+#include <stdio.h>
 #include <string.h>
 #include "userprog/syscall.h"
 #include "vm/swap.h"
 #include "vm/frame.h"
+#include "vm/share.h"
+#include "vm/mmfile.h"
 #include "threads/synch.h"
 
 
@@ -64,19 +67,37 @@ get_addr_pte (struct hash* ht, void* uvaddr){
 	}
 }
 
+/* Returns true if PTE is a read-only page of an executable, which
+   is kept in the share table. */
+static bool
+shareable (const struct sup_pte *pte)
+{
+	return pte->type == FILE && !pte->file_info.writable
+	       && pte->file_info.read_length > 0;
+}
+
 bool load_back (struct sup_pte* pte){
 	if (pte->type == FILE){
+		/* A page of an executable, read on first touch.  Pages
+		   that are entirely zero (.bss) never touch the file. */
 		struct thread* cur = thread_current ();
-		file_seek (pte->file_info.file, pte->file_info.offset);
-		uint8_t *newpage = allocate_frame (PAL_USER);
+		uint32_t length = pte->file_info.read_length;
+		if (shareable (pte))
+			return share_load (pte);
+		uint8_t *newpage = allocate_frame (length == 0 ? PAL_USER | PAL_ZERO : PAL_USER);
 		if (!newpage) return false;
-		uint32_t result = file_read (pte->file_info.file, newpage, pte->file_info.read_length);
-		if (result != pte->file_info.read_length){
+		if (length > 0){
+			if ((uint32_t) file_read_at (pte->file_info.file, newpage, length,
+			                             pte->file_info.offset) != length){
+				free_frame (newpage);
+				return false;
+			}
+			memset (newpage + length, 0, pte->file_info.empty_length);
+		}
+		if (!pagedir_set_page (cur->pagedir, pte->user_vaddr, newpage, pte->file_info.writable)){
 			free_frame (newpage);
 			return false;
 		}
-		memset (newpage + pte->file_info.read_length, 0, pte->file_info.empty_length);
-		pagedir_set_page (cur->pagedir, pte->user_vaddr, newpage, pte->file_info.writable);
 		pte->loaded = true;
 		return true;
 	}
@@ -101,16 +122,119 @@ bool load_back (struct sup_pte* pte){
 		uint8_t* newpage = allocate_frame (PAL_USER);
 		if (newpage == NULL)
 			return false;
-		pagedir_set_page (cur->pagedir, pte->user_vaddr, newpage, pte->writable);
-		swap_in (pte->swap_index, pte->user_vaddr);
+		/* Fill the frame before mapping it, so that the other
+		   threads of the process never see it half read. */
+		swap_in (pte->swap_index, newpage);
+		if (!pagedir_set_page (cur->pagedir, pte->user_vaddr, newpage, pte->writable)){
+			/* swap_in() gave up the slot, so the page is lost. */
+			free_frame (newpage);
+			pte->type &= ~SWAP;
+			return false;
+		}
 		if (pte->type == SWAP)
-			hash_delete (&cur->sup_page_table, &pte->elem);
+			hash_delete (&cur->process->sup_page_table, &pte->elem);
 		if (pte->type == (0x2|0x1)){
 			pte->type = FILE;
 			pte->loaded = true;
+			pte->cow = false;
 		}
 		return true;
 	}
+	return false;
+}
+
+/* Read-ahead.  A fault on the page that follows the last one
+   faulted in, or the last one read ahead, continues a sequential
+   scan, and the pages after it that come from the next blocks of
+   the same file or the next swap slots are loaded along with it.
+   The window starts at READ_AHEAD_MIN pages and doubles with each
+   sequential fault, up to page_read_ahead_max; any other fault
+   collapses it.  Pages read ahead are mapped with their accessed
+   bits clear, so the clock evicts them first if they go unused. */
+#define READ_AHEAD_MIN 2
+
+int page_read_ahead_max = 16;
+
+/* Statistics. */
+static long long seq_fault_cnt;     /* Faults continuing a scan. */
+static long long ra_page_cnt;       /* Pages read ahead. */
+
+/* Returns true if PTE is loaded from swap rather than a file. */
+static bool
+from_swap (const struct sup_pte *pte)
+{
+	return pte->type == SWAP || pte->type == (FILE|SWAP);
+}
+
+/* Returns true if NEXT, the page after PREV, continues PREV's
+   file or swap cluster, so that reading it ahead of use is
+   likely to pay off. */
+static bool
+continues (const struct sup_pte *prev, const struct sup_pte *next)
+{
+	if (next->loaded || next->type == ANON)
+		return false;
+	if (from_swap (prev))
+		return from_swap (next) && next->swap_index == prev->swap_index + 1;
+	return (!from_swap (next)
+	        && (next->type & MMF) == (prev->type & MMF)
+	        && next->file_info.file == prev->file_info.file
+	        && next->file_info.offset == prev->file_info.offset + PGSIZE);
+}
+
+/* Loads PTE, which the current process faulted on, and reads
+   ahead of it if the fault continues a sequential scan.  Must be
+   called with the process's vm_lock held. */
+bool
+load_back_ahead (struct sup_pte* pte){
+	struct thread *cur = thread_current ();
+	struct process *p = cur->process;
+	uint8_t *upage = (uint8_t *) pte->user_vaddr;
+	struct sup_pte prev = *pte;
+	int i;
+
+	if (!load_back (pte))
+		return false;
+
+	if (upage == p->ra_next && page_read_ahead_max > 0){
+		seq_fault_cnt++;
+		p->ra_window = p->ra_window == 0 ? READ_AHEAD_MIN : p->ra_window * 2;
+		if (p->ra_window > page_read_ahead_max)
+			p->ra_window = page_read_ahead_max;
+	}
+	else
+		p->ra_window = 0;
+	p->ra_next = upage + PGSIZE;
+	if (p->ra_window == 0)
+		return true;
+
+	/* The process has not touched the page just faulted in yet;
+	   keep the clock from evicting it to make room. */
+	pagedir_set_accessed (cur->pagedir, upage, true);
+	for (i = 1; i <= p->ra_window; i++){
+		uint8_t *next = upage + i * PGSIZE;
+		struct sup_pte *n;
+
+		if (!is_user_vaddr (next) || pagedir_get_page (cur->pagedir, next) != NULL)
+			break;
+		n = get_addr_pte (&p->sup_page_table, next);
+		if (n == NULL || !continues (&prev, n))
+			break;
+		prev = *n;
+		if (!load_back (n))
+			break;
+		ra_page_cnt++;
+		p->ra_next = next + PGSIZE;
+	}
+	return true;
+}
+
+/* Prints read-ahead statistics. */
+void
+page_print_stats (void)
+{
+	printf ("Read-ahead: %lld sequential faults, %lld pages read ahead\n",
+	        seq_fault_cnt, ra_page_cnt);
 }
 
 /* used by hash func to free a hash table */
@@ -172,4 +296,185 @@ void write_mmf_back (struct sup_pte* pte){
 // }
 // void unfix_page (struct hash* ht, void* uvaddr){
 
-// }
\ No newline at end of file
+// }
+
+/* Copy-on-write fork. */
+
+/* State of fork_pages(). */
+struct fork_aux
+  {
+    struct process *parent;
+    struct process *child;
+    bool success;
+  };
+
+/* Shares page UPAGE, present in the parent at KPAGE, with the
+   child.  Private pages are mapped read-only into both and copied
+   by cow_break() on the first write.  Executable text is left for
+   the child to find in the share table, and memory-mapped file
+   pages for it to read from the file, which is brought up to date
+   here. */
+static void
+fork_present_page (void *upage, void *kpage, void *aux_)
+{
+	struct fork_aux *aux = aux_;
+	struct process *parent = aux->parent;
+	struct process *child = aux->child;
+	struct frame_table_entry *fte = get_frame (kpage);
+	struct sup_pte *pte;
+
+	if (!aux->success || fte == NULL)
+		return;
+
+	pte = get_addr_pte (&parent->sup_page_table, upage);
+	if (pte != NULL && pte->type == MMF){
+		if (pagedir_is_dirty (parent->pagedir, upage)){
+			file_write_at (pte->file_info.file, kpage,
+			               pte->file_info.read_length, pte->file_info.offset);
+			pagedir_set_dirty (parent->pagedir, upage, false);
+		}
+		return;
+	}
+	if (pte != NULL && shareable (pte))
+		return;
+
+	/* A stack page has no entry until it is first evicted. */
+	if (pte == NULL){
+		pte = malloc (sizeof *pte);
+		if (pte == NULL){
+			aux->success = false;
+			return;
+		}
+		pte->user_vaddr = upage;
+		pte->type = ANON;
+		pte->swap_index = 0;
+		pte->loaded = true;
+		pte->writable = pagedir_is_writable (parent->pagedir, upage);
+		pte->cow = false;
+		insert_sup_pte (&parent->sup_page_table, pte);
+	}
+	if (!pte->cow){
+		pte->cow = true;
+		pagedir_set_writable (parent->pagedir, upage, false);
+	}
+
+	if (!pagedir_set_page (child->pagedir, upage, kpage, false)){
+		aux->success = false;
+		return;
+	}
+	/* Keep a page that differs from its file from being dropped
+	   on eviction in the child. */
+	if (pagedir_is_dirty (parent->pagedir, upage))
+		pagedir_set_dirty (child->pagedir, upage, true);
+	if (!share_cow (fte, parent, child, upage)){
+		pagedir_clear_page (child->pagedir, upage);
+		aux->success = false;
+	}
+}
+
+/* Adds a copy of the parent's entry PTE to the child in AUX. */
+static bool
+fork_sup_pte (struct sup_pte *pte, struct fork_aux *aux)
+{
+	struct process *child = aux->child;
+	struct sup_pte *copy = malloc (sizeof *copy);
+
+	if (copy == NULL)
+		return false;
+	*copy = *pte;
+	if (pte->type & MMF){
+		copy->type = MMF;
+		copy->loaded = false;
+		copy->file_info.file = mmf_get_file (&child->mmfiles, pte->user_vaddr);
+	}
+	else{
+		if (pte->type & FILE)
+			copy->file_info.file = child->executing_file;
+		if (pte->type & SWAP)
+			swap_dup (pte->swap_index);
+		else if (pte->loaded && !pte->cow)
+			copy->loaded = false;
+	}
+	insert_sup_pte (&child->sup_page_table, copy);
+	return true;
+}
+
+/* Gives CHILD, whose page directory is empty, a copy-on-write
+   copy of PARENT's user pages.  CHILD's executable and
+   memory-mapped files must already be open.  Returns true if
+   successful, false if out of memory. */
+bool
+fork_pages (struct process *parent, struct process *child)
+{
+	struct fork_aux aux;
+	struct hash_iterator i;
+
+	aux.parent = parent;
+	aux.child = child;
+	aux.success = true;
+
+	lock_acquire (&parent->vm_lock);
+	lock_acquire (&e_lock);
+	pagedir_for_each (parent->pagedir, fork_present_page, &aux);
+	if (aux.success){
+		hash_first (&i, &parent->sup_page_table);
+		while (hash_next (&i))
+			if (!fork_sup_pte (hash_entry (hash_cur (&i), struct sup_pte, elem),
+			                   &aux)){
+				aux.success = false;
+				break;
+			}
+	}
+	lock_release (&e_lock);
+	lock_release (&parent->vm_lock);
+	return aux.success;
+}
+
+/* Gives the current process its own writable copy of PTE's page,
+   which is present and mapped copy-on-write.  The caller must
+   hold the process's vm_lock.  Returns false if the page is not
+   writable at all. */
+bool
+cow_break (struct sup_pte* pte)
+{
+	uint32_t *pd = thread_current ()->pagedir;
+	void *upage = pte->user_vaddr;
+	bool locker = lock_held_by_current_thread (&e_lock);
+	bool success = true;
+	struct frame_table_entry *fte;
+	void *kpage;
+
+	if (!pte->writable)
+		return false;
+
+	if (!locker)
+		lock_acquire (&e_lock);
+	kpage = pagedir_get_page (pd, upage);
+	fte = get_frame (kpage);
+	if (fte->shared != NULL){
+		bool dirty = pagedir_is_dirty (pd, upage);
+		uint8_t *copy;
+
+		/* Keep the page from being evicted while we copy it. */
+		fix_frame (upage);
+		copy = allocate_frame (PAL_USER);
+		memcpy (copy, kpage, PGSIZE);
+		unfix_frame (upage);
+
+		share_unmap (fte, pd);
+		pagedir_clear_page (pd, upage);
+		success = pagedir_set_page (pd, upage, copy, true);
+		if (success)
+			pagedir_set_dirty (pd, upage, dirty);
+		else{
+			free_frame (copy);
+			pte->loaded = false;
+		}
+	}
+	else
+		pagedir_set_writable (pd, upage, true);
+	pte->cow = false;
+	if (!locker)
+		lock_release (&e_lock);
+	return success;
+}
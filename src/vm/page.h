@@ -5,7 +5,9 @@
 #include "threads/palloc.h"
 #include "lib/kernel/hash.h"
 #include "filesys/file.h"
+#include "userprog/process.h"
 
+#define ANON 0x0  /* Resident anonymous page, e.g. forked stack. */
 #define SWAP 0x1
 #define FILE 0x2
 #define MMF  0x4
@@ -25,6 +27,7 @@ struct sup_pte{
 	size_t swap_index;
 	bool loaded;
 	bool writable;
+	bool cow;          /* Mapped read-only, copied on first write. */
 	struct hash_elem elem;
 };
 
@@ -35,10 +38,19 @@ unsigned sup_pte_hash (const struct hash_elem *ht, void *aux UNUSED);
 bool sup_pte_less (const struct hash_elem *hta, const struct hash_elem *htb, void *aux UNUSED);
 struct sup_pte* get_addr_pte (struct hash* ht, void* uvaddr);
 bool load_back (struct sup_pte* pte);
+bool load_back_ahead (struct sup_pte* pte);
+void page_print_stats (void);
 void free_sup_page_table (struct hash* table);
 bool insert_sup_pte (struct hash* ht, struct sup_pte* pte);
 void fix_page (struct hash* ht, void* uvaddr);
 void unfix_page (struct hash* ht, void* uvaddr);
+bool fork_pages (struct process *parent, struct process *child);
+bool cow_break (struct sup_pte* pte);
+/* Most pages to read ahead of a sequential fault, 0 to disable
+   read-ahead.  Controlled by kernel command-line option
+   "-readahead=N". */
+extern int page_read_ahead_max;
+
 //fuck bool add_file_pte (struct file *file, off_t offset, uint8_t *user_page, uint32_t read_length, uint32_t empty_length, bool writable);
 //bool add_mmf_pte (struct file *file, off_t offset, uint8_t *user_page, uint32_t read_length);
 
@@ -0,0 +1,433 @@
+#include "vm/share.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/swap.h"
+
+/* A page held in a frame that several processes map: either a
+   read-only executable page, or a page shared copy-on-write
+   after fork(), in which case INODE is null. */
+struct shared_page
+  {
+    struct inode *inode;        /* Executable, or null. */
+    off_t offset;               /* Offset of the page in INODE. */
+    uint32_t read_length;       /* Bytes read from INODE; rest is zero. */
+    void *frame;                /* Kernel virtual address of the frame. */
+    struct list mappings;       /* List of struct page_mapping. */
+    struct hash_elem elem;      /* Element in share_table. */
+  };
+
+/* One process's mapping of a shared page. */
+struct page_mapping
+  {
+    struct process *process;    /* Mapping process. */
+    void *vaddr;                /* User address of the mapping. */
+    bool locked;                /* PROCESS's vm_lock taken to evict? */
+    struct list_elem elem;      /* Element in shared_page's mappings. */
+  };
+
+/* Shared pages, keyed by inode, offset and length.  Guarded, like
+   the supplemental page tables, by e_lock. */
+static struct hash share_table;
+
+/* Statistics. */
+static long long share_hit_cnt;     /* Faults that found the page. */
+static long long share_miss_cnt;    /* Faults that read it from disk. */
+
+static unsigned shared_page_hash (const struct hash_elem *, void *);
+static bool shared_page_less (const struct hash_elem *,
+                              const struct hash_elem *, void *);
+static void update_owner (struct frame_table_entry *);
+static void remove_shared_page (struct shared_page *);
+static void unlock_mappers (struct shared_page *);
+static void make_private (struct frame_table_entry *);
+static struct page_mapping *add_mapping (struct shared_page *,
+                                         struct process *, void *vaddr);
+
+/* Initializes the share table. */
+void
+share_init (void)
+{
+  hash_init (&share_table, shared_page_hash, shared_page_less, NULL);
+}
+
+/* Maps PTE, a read-only page of an executable, into the current
+   process, reading it from disk only if no other process already
+   has it in memory.  Returns true if successful. */
+bool
+share_load (struct sup_pte *pte)
+{
+  struct process *p = thread_current ()->process;
+  struct shared_page key, *sp;
+  struct page_mapping *m;
+  struct hash_elem *e;
+  bool locker = lock_held_by_current_thread (&e_lock);
+  bool success = false;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return false;
+  m->process = p;
+  m->vaddr = pte->user_vaddr;
+  m->locked = false;
+
+  if (!locker)
+    lock_acquire (&e_lock);
+
+  key.inode = file_get_inode (pte->file_info.file);
+  key.offset = pte->file_info.offset;
+  key.read_length = pte->file_info.read_length;
+  e = hash_find (&share_table, &key.elem);
+  if (e != NULL)
+    {
+      sp = hash_entry (e, struct shared_page, elem);
+      share_hit_cnt++;
+    }
+  else
+    {
+      sp = malloc (sizeof *sp);
+      if (sp == NULL)
+        goto done;
+      sp->frame = allocate_frame (PAL_USER);
+      if ((uint32_t) file_read_at (pte->file_info.file, sp->frame,
+                                   key.read_length, key.offset)
+          != key.read_length)
+        {
+          free_frame (sp->frame);
+          free (sp);
+          goto done;
+        }
+      memset ((uint8_t *) sp->frame + key.read_length, 0,
+              PGSIZE - key.read_length);
+      sp->inode = key.inode;
+      sp->offset = key.offset;
+      sp->read_length = key.read_length;
+      list_init (&sp->mappings);
+      hash_insert (&share_table, &sp->elem);
+      get_frame (sp->frame)->shared = sp;
+      share_miss_cnt++;
+    }
+
+  if (!pagedir_set_page (p->pagedir, pte->user_vaddr, sp->frame, false))
+    {
+      if (list_empty (&sp->mappings))
+        {
+          void *frame = sp->frame;
+          remove_shared_page (sp);
+          free_frame (frame);
+        }
+      goto done;
+    }
+  list_push_back (&sp->mappings, &m->elem);
+  m = NULL;
+  update_owner (get_frame (sp->frame));
+  pte->loaded = true;
+  success = true;
+
+ done:
+  if (!locker)
+    lock_release (&e_lock);
+  free (m);
+  return success;
+}
+
+/* Maps FTE's page, which PARENT maps at VADDR, into CHILD at the
+   same address as well, copy-on-write.  CHILD's page directory
+   must already map it.  Must be called with e_lock held.
+   Returns true if successful, false if out of memory. */
+bool
+share_cow (struct frame_table_entry *fte, struct process *parent,
+           struct process *child, void *vaddr)
+{
+  struct shared_page *sp = fte->shared;
+
+  if (sp == NULL)
+    {
+      sp = malloc (sizeof *sp);
+      if (sp == NULL)
+        return false;
+      sp->inode = NULL;
+      sp->offset = 0;
+      sp->read_length = 0;
+      sp->frame = fte->frame;
+      list_init (&sp->mappings);
+      if (add_mapping (sp, parent, vaddr) == NULL)
+        {
+          free (sp);
+          return false;
+        }
+      fte->shared = sp;
+    }
+  if (add_mapping (sp, child, vaddr) == NULL)
+    {
+      if (list_size (&sp->mappings) == 1)
+        make_private (fte);
+      return false;
+    }
+  update_owner (fte);
+  return true;
+}
+
+/* Drops page directory PD's mapping of FTE's shared page.
+   Returns true if no other process maps the page, in which case
+   the caller must free the frame.  A copy-on-write page left with
+   a single mapper becomes that process's private page again. */
+bool
+share_unmap (struct frame_table_entry *fte, uint32_t *pd)
+{
+  struct shared_page *sp = fte->shared;
+  struct list_elem *e;
+  bool locker = lock_held_by_current_thread (&e_lock);
+  bool last;
+
+  if (!locker)
+    lock_acquire (&e_lock);
+  for (e = list_begin (&sp->mappings); e != list_end (&sp->mappings);
+       e = list_next (e))
+    {
+      struct page_mapping *m = list_entry (e, struct page_mapping, elem);
+      if (m->process->pagedir == pd)
+        {
+          list_remove (e);
+          free (m);
+          break;
+        }
+    }
+  last = list_empty (&sp->mappings);
+  if (last)
+    remove_shared_page (sp);
+  else if (sp->inode == NULL && list_size (&sp->mappings) == 1)
+    make_private (fte);
+  else
+    update_owner (fte);
+  if (!locker)
+    lock_release (&e_lock);
+  return last;
+}
+
+/* Returns true if any process has accessed FTE's shared page
+   since its accessed bits were last cleared.  Clears them all if
+   CLEAR is true.  Must be called with e_lock held. */
+bool
+share_accessed (struct frame_table_entry *fte, bool clear)
+{
+  struct shared_page *sp = fte->shared;
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin (&sp->mappings); e != list_end (&sp->mappings);
+       e = list_next (e))
+    {
+      struct page_mapping *m = list_entry (e, struct page_mapping, elem);
+      if (pagedir_is_accessed (m->process->pagedir, m->vaddr))
+        {
+          accessed = true;
+          if (clear)
+            pagedir_set_accessed (m->process->pagedir, m->vaddr, false);
+        }
+    }
+  return accessed;
+}
+
+/* Returns true if eviction is likely to get the vm_lock of every
+   process that maps FTE's shared page.  Must be called with e_lock
+   held. */
+bool
+share_idle (struct frame_table_entry *fte)
+{
+  struct list *mappings = &fte->shared->mappings;
+  struct list_elem *e;
+
+  for (e = list_begin (mappings); e != list_end (mappings); e = list_next (e))
+    if (!frame_process_idle (list_entry (e, struct page_mapping,
+                                         elem)->process))
+      return false;
+  return true;
+}
+
+/* Takes the vm_lock of every process that maps FTE's shared page,
+   so that share_evict() may change their page tables.  Returns
+   false, holding none of them, if one is busy.  Must be called
+   with e_lock held. */
+bool
+share_lock (struct frame_table_entry *fte)
+{
+  struct list *mappings = &fte->shared->mappings;
+  struct list_elem *e;
+
+  for (e = list_begin (mappings); e != list_end (mappings); e = list_next (e))
+    {
+      struct page_mapping *m = list_entry (e, struct page_mapping, elem);
+      if (!frame_lock_process (m->process, &m->locked))
+        {
+          unlock_mappers (fte->shared);
+          return false;
+        }
+    }
+  return true;
+}
+
+/* Unmaps FTE's shared page from every process that maps it, so
+   that the frame can be reused.  An executable page is read-only,
+   so it is never dirty and is simply read back in on the next
+   fault.  A copy-on-write page is written to a single swap slot
+   that all of its mappers refer to.  Returns false if swap is
+   full.  Must be called with e_lock held, after share_lock();
+   releases the locks that share_lock() took. */
+bool
+share_evict (struct frame_table_entry *fte)
+{
+  struct shared_page *sp = fte->shared;
+  size_t swap_idx = SIZE_MAX;
+
+  if (sp->inode == NULL)
+    {
+      swap_idx = swap_out (sp->frame);
+      if (swap_idx == SIZE_MAX)
+        {
+          unlock_mappers (sp);
+          return false;
+        }
+    }
+
+  while (!list_empty (&sp->mappings))
+    {
+      struct list_elem *e = list_pop_front (&sp->mappings);
+      struct page_mapping *m = list_entry (e, struct page_mapping, elem);
+      struct sup_pte *spte = get_addr_pte (&m->process->sup_page_table,
+                                           m->vaddr);
+      if (sp->inode == NULL)
+        {
+          ASSERT (spte != NULL);
+          if (!list_empty (&sp->mappings))
+            swap_dup (swap_idx);
+          spte->type |= SWAP;
+          spte->swap_index = swap_idx;
+        }
+      if (spte != NULL)
+        spte->loaded = false;
+      pagedir_clear_page (m->process->pagedir, m->vaddr);
+      if (m->locked)
+        lock_release (&m->process->vm_lock);
+      free (m);
+    }
+  remove_shared_page (sp);
+  return true;
+}
+
+/* Prints sharing statistics. */
+void
+share_print_stats (void)
+{
+  printf ("Share: %lld text faults shared, %lld read from disk\n",
+          share_hit_cnt, share_miss_cnt);
+}
+
+/* Makes the first process still mapping FTE's shared page its
+   owner, as seen by the eviction clock. */
+static void
+update_owner (struct frame_table_entry *fte)
+{
+  struct page_mapping *m = list_entry (list_front (&fte->shared->mappings),
+                                       struct page_mapping, elem);
+  fte->owner = m->process;
+  fte->vaddr = m->vaddr;
+}
+
+/* Removes SP, which no process maps any longer, from the share
+   table and detaches it from its frame. */
+static void
+remove_shared_page (struct shared_page *sp)
+{
+  struct frame_table_entry *fte = get_frame (sp->frame);
+
+  ASSERT (list_empty (&sp->mappings));
+  if (sp->inode != NULL)
+    hash_delete (&share_table, &sp->elem);
+  fte->shared = NULL;
+  fte->vaddr = NULL;
+  free (sp);
+}
+
+/* Releases the vm_locks that share_lock() took for SP's
+   mappers. */
+static void
+unlock_mappers (struct shared_page *sp)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&sp->mappings); e != list_end (&sp->mappings);
+       e = list_next (e))
+    {
+      struct page_mapping *m = list_entry (e, struct page_mapping, elem);
+      if (m->locked)
+        {
+          lock_release (&m->process->vm_lock);
+          m->locked = false;
+        }
+    }
+}
+
+/* Turns FTE's copy-on-write page, which a single process still
+   maps, back into a private page of that process. */
+static void
+make_private (struct frame_table_entry *fte)
+{
+  struct shared_page *sp = fte->shared;
+  struct page_mapping *m = list_entry (list_pop_front (&sp->mappings),
+                                       struct page_mapping, elem);
+
+  ASSERT (sp->inode == NULL && list_empty (&sp->mappings));
+  fte->owner = m->process;
+  fte->vaddr = m->vaddr;
+  fte->shared = NULL;
+  free (m);
+  free (sp);
+}
+
+/* Adds a mapping of SP by process P at VADDR.  Returns the new
+   mapping, or a null pointer if out of memory. */
+static struct page_mapping *
+add_mapping (struct shared_page *sp, struct process *p, void *vaddr)
+{
+  struct page_mapping *m = malloc (sizeof *m);
+
+  if (m != NULL)
+    {
+      m->process = p;
+      m->vaddr = vaddr;
+      m->locked = false;
+      list_push_back (&sp->mappings, &m->elem);
+    }
+  return m;
+}
+
+static unsigned
+shared_page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct shared_page *sp = hash_entry (e, struct shared_page, elem);
+  return hash_bytes (&sp->inode, sizeof sp->inode) ^ hash_int (sp->offset);
+}
+
+static bool
+shared_page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct shared_page *a = hash_entry (a_, struct shared_page, elem);
+  const struct shared_page *b = hash_entry (b_, struct shared_page, elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  if (a->offset != b->offset)
+    return a->offset < b->offset;
+  return a->read_length < b->read_length;
+}
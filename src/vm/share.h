@@ -0,0 +1,31 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "vm/page.h"
+#include "vm/frame.h"
+
+/* Read-only pages of executables are shared by every process
+   running the same executable.  The share table maps an
+   executable page, identified by its inode, file offset and
+   length, to the frame that holds it; the frame keeps a reverse
+   map of every process that maps it, so that eviction can unmap
+   it from all of them at once.
+
+   fork() uses the same reverse map for the private pages that a
+   parent and child share copy-on-write, but those are not in the
+   share table and are swapped out, not dropped, on eviction. */
+
+void share_init (void);
+bool share_load (struct sup_pte *);
+bool share_cow (struct frame_table_entry *, struct process *parent,
+                struct process *child, void *vaddr);
+bool share_unmap (struct frame_table_entry *, uint32_t *pd);
+bool share_accessed (struct frame_table_entry *, bool clear);
+bool share_idle (struct frame_table_entry *);
+bool share_lock (struct frame_table_entry *);
+bool share_evict (struct frame_table_entry *);
+void share_print_stats (void);
+
+#endif /* vm/share.h */
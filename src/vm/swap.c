@@ -1,45 +1,292 @@
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
 #include "lib/kernel/bitmap.h"
 #include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "vm/swap.h"
+#include "vm/zswap.h"
 
 
 struct block *swap_disk;
 
 struct bitmap *swap_table;
 
+/* Number of pages referring to each slot in use.  A slot is
+   shared by the processes that shared a copy-on-write page when
+   it was swapped out, and freed when the last one lets go. */
+static uint16_t *swap_refs;
+
 static size_t NUM_SECTORS_PAGE = PGSIZE / BLOCK_SECTOR_SIZE;
 
+/* Swapped-out pages go to the compressed cache in zswap.c if
+   they fit.  Otherwise, and when the cache writes back older
+   pages to make room, they are not written to disk directly but
+   copied into a cluster, a buffer for a run of adjacent slots,
+   and written behind by the swap worker thread with one disk
+   request per cluster.  Eviction thus only waits for the disk
+   when every cluster is full of data still being written. */
+#define SWAP_CLUSTER 8          /* Pages per cluster. */
+#define SWAP_CLUSTER_CNT 4      /* Number of clusters. */
+
+struct swap_cluster
+  {
+    struct list_elem elem;      /* Element in one of the lists below. */
+    size_t first;               /* First slot. */
+    size_t cnt;                 /* Number of slots, 0 if unused. */
+    uint8_t *buffer;            /* SWAP_CLUSTER pages of data. */
+  };
+
+/* Protects everything below, swap_table, and swap_refs. */
+static struct lock swap_lock;
+
+static struct list free_clusters;   /* Unused clusters. */
+static struct list full_clusters;   /* Waiting to be written, oldest
+                                       first. */
+static struct swap_cluster *open_cluster;    /* Being filled, or null. */
+static struct swap_cluster *write_cluster;   /* Being written, or null. */
+static struct condition cluster_freed;  /* Signaled when a cluster
+                                           returns to free_clusters. */
+
+static struct work_queue *swap_wq;  /* Runs swap_write_behind(). */
+static struct work swap_work;
+
+/* Statistics. */
+static long long page_write_cnt;    /* Pages written. */
+static long long write_req_cnt;     /* Disk requests for them. */
+static long long page_read_cnt;     /* Pages read. */
+static long long buffer_read_cnt;   /* Of those, found in a cluster. */
+
+static void swap_write_behind (struct work *);
+
 size_t swap_page_num (void){
 	return block_size (swap_disk) / NUM_SECTORS_PAGE;
 }
 
 void swap_init (void){
+	uint8_t *buffer;
+	int i;
+
 	swap_disk = block_get_role (BLOCK_SWAP);
 	if (swap_disk == NULL) ASSERT (0);
 	// printf("swap_page_num = %d\n", swap_page_num());
 	swap_table = bitmap_create (swap_page_num ());
 	ASSERT (!swap_table == NULL);
 	bitmap_set_all (swap_table, true);
+	swap_refs = calloc (swap_page_num (), sizeof *swap_refs);
+	ASSERT (swap_refs != NULL);
+
+	lock_init (&swap_lock);
+	zswap_init ();
+	cond_init (&cluster_freed);
+	list_init (&free_clusters);
+	list_init (&full_clusters);
+	buffer = palloc_get_multiple (PAL_ASSERT, SWAP_CLUSTER * SWAP_CLUSTER_CNT);
+	for (i = 0; i < SWAP_CLUSTER_CNT; i++){
+		struct swap_cluster *c = malloc (sizeof *c);
+		ASSERT (c != NULL);
+		c->cnt = 0;
+		c->buffer = buffer + i * SWAP_CLUSTER * PGSIZE;
+		list_push_back (&free_clusters, &c->elem);
+	}
+	swap_wq = work_queue_create ("swap", 1, PRI_DEFAULT);
+	work_init (&swap_work, swap_write_behind, NULL);
+}
+
+/* Moves the open cluster, if any, to the list to be written. */
+static void
+close_cluster (void){
+	if (open_cluster != NULL){
+		list_push_back (&full_clusters, &open_cluster->elem);
+		open_cluster = NULL;
+	}
 }
 
+/* Returns the page of a cluster that will be written to slot
+   SLOT, extending the open cluster if SLOT follows it and
+   otherwise starting a new one.  If WAIT is false, returns a
+   null pointer instead of waiting for a cluster to be freed. */
+static void *
+cluster_add (size_t slot, bool wait){
+	struct swap_cluster *c;
+	void *page;
+
+	for (;;){
+		c = open_cluster;
+		if (c != NULL && c->first + c->cnt == slot)
+			break;
+		if (!list_empty (&free_clusters)){
+			close_cluster ();
+			c = list_entry (list_pop_front (&free_clusters), struct swap_cluster, elem);
+			c->first = slot;
+			c->cnt = 0;
+			open_cluster = c;
+			break;
+		}
+		if (!wait)
+			return NULL;
+		cond_wait (&cluster_freed, &swap_lock);
+	}
+	page = c->buffer + c->cnt++ * PGSIZE;
+	if (c->cnt == SWAP_CLUSTER)
+		close_cluster ();
+	return page;
+}
+
+/* Makes room in the compressed cache by moving its page for
+   SLOT to a cluster, unless that would mean waiting. */
+static void *
+spill_page (size_t slot){
+	return cluster_add (slot, false);
+}
+
+/* Saves the page at PAGE_IDX, a kernel virtual address, in a
+   free swap slot and returns the slot, or SIZE_MAX if swap is
+   full.  The page is compressed or written to disk
+   asynchronously; PAGE_IDX may be reused as soon as this
+   function returns. */
 size_t swap_out (void* page_idx){
-	size_t free_page = bitmap_scan_and_flip (swap_table, 0, 1, true);
-	if(free_page == BITMAP_ERROR) return SIZE_MAX;
-	for (int i = 0; i < NUM_SECTORS_PAGE; i++)
-		block_write (swap_disk, free_page * NUM_SECTORS_PAGE + i, page_idx + i * BLOCK_SECTOR_SIZE);
+	size_t free_page;
+	bool write;
+
+	lock_acquire (&swap_lock);
+	free_page = bitmap_scan_and_flip (swap_table, 0, 1, true);
+	if(free_page == BITMAP_ERROR){
+		lock_release (&swap_lock);
+		return SIZE_MAX;
+	}
+	swap_refs[free_page] = 1;
+	if (!zswap_store (free_page, page_idx, spill_page))
+		memcpy (cluster_add (free_page, true), page_idx, PGSIZE);
+	write = open_cluster != NULL || !list_empty (&full_clusters);
+	lock_release (&swap_lock);
+
+	if (write)
+		work_submit (swap_wq, &swap_work);
 	return free_page;
 }
 
+/* Returns the page of cluster C that holds slot SLOT, or a null
+   pointer if C does not hold SLOT. */
+static void *
+cluster_page (struct swap_cluster *c, size_t slot){
+	if (c == NULL || slot < c->first || slot >= c->first + c->cnt)
+		return NULL;
+	return c->buffer + (slot - c->first) * PGSIZE;
+}
+
+/* Looks for slot SLOT in the clusters not yet written, newest
+   first since a slot freed and reused while still waiting to be
+   written may appear more than once.  Returns its data, or a null
+   pointer if it is only on disk. */
+static void *
+find_pending (size_t slot){
+	struct list_elem *e;
+	void *page;
+
+	ASSERT (lock_held_by_current_thread (&swap_lock));
+	if ((page = cluster_page (open_cluster, slot)) != NULL)
+		return page;
+	for (e = list_rbegin (&full_clusters); e != list_rend (&full_clusters);
+	     e = list_prev (e))
+		if ((page = cluster_page (list_entry (e, struct swap_cluster, elem),
+		                          slot)) != NULL)
+			return page;
+	return cluster_page (write_cluster, slot);
+}
+
+/* Reads slot AIM_SWAP_PAGE into PAGE_IDX, a kernel virtual
+   address, and drops the caller's reference to the slot. */
 void swap_in (size_t aim_swap_page, void* page_idx){
+	void *pending;
+
 	ASSERT (!(aim_swap_page == BITMAP_ERROR || page_idx == NULL));
-	for (int i = 0; i < NUM_SECTORS_PAGE; i++)
-		block_read (swap_disk, aim_swap_page * NUM_SECTORS_PAGE + i, page_idx + i * BLOCK_SECTOR_SIZE);
+	lock_acquire (&swap_lock);
+	page_read_cnt++;
+	if (zswap_load (aim_swap_page, page_idx)){
+		lock_release (&swap_lock);
+		swap_clear (aim_swap_page);
+		return;
+	}
+	pending = find_pending (aim_swap_page);
+	if (pending != NULL){
+		buffer_read_cnt++;
+		memcpy (page_idx, pending, PGSIZE);
+	}
+	lock_release (&swap_lock);
 
-	bitmap_flip (swap_table, aim_swap_page);
+	/* The slot cannot be rewritten while we hold a reference to
+	   it, so if it is not pending its data is on disk. */
+	if (pending == NULL)
+		block_read_multiple (swap_disk, aim_swap_page * NUM_SECTORS_PAGE,
+		                     page_idx, NUM_SECTORS_PAGE);
+
+	swap_clear (aim_swap_page);
 }
 
+/* Drops a reference to a slot, freeing it if it was the last. */
 void swap_clear (size_t aim_swap_page){
-	bitmap_flip (swap_table, aim_swap_page);
+	lock_acquire (&swap_lock);
+	ASSERT (swap_refs[aim_swap_page] > 0);
+	if (--swap_refs[aim_swap_page] == 0){
+		zswap_invalidate (aim_swap_page);
+		bitmap_flip (swap_table, aim_swap_page);
+	}
+	lock_release (&swap_lock);
+}
+
+/* Adds a reference to a slot in use. */
+void swap_dup (size_t aim_swap_page){
+	lock_acquire (&swap_lock);
+	ASSERT (swap_refs[aim_swap_page] > 0);
+	swap_refs[aim_swap_page]++;
+	lock_release (&swap_lock);
+}
+
+/* Swap worker: writes clusters to disk, oldest first, until none
+   is left.  The open cluster is written only once the others are
+   done, so that it gathers the pages evicted meanwhile. */
+static void
+swap_write_behind (struct work *w UNUSED){
+	lock_acquire (&swap_lock);
+	for (;;){
+		struct swap_cluster *c;
+
+		if (!list_empty (&full_clusters))
+			c = list_entry (list_pop_front (&full_clusters), struct swap_cluster, elem);
+		else if (open_cluster != NULL){
+			c = open_cluster;
+			open_cluster = NULL;
+		}
+		else
+			break;
+
+		write_cluster = c;
+		page_write_cnt += c->cnt;
+		write_req_cnt++;
+		lock_release (&swap_lock);
+		block_write_multiple (swap_disk, c->first * NUM_SECTORS_PAGE,
+		                      c->buffer, c->cnt * NUM_SECTORS_PAGE);
+		lock_acquire (&swap_lock);
+
+		write_cluster = NULL;
+		c->cnt = 0;
+		list_push_back (&free_clusters, &c->elem);
+		cond_signal (&cluster_freed, &swap_lock);
+	}
+	lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  printf ("Swap: %lld pages written in %lld requests, "
+          "%lld pages read (%lld from write-behind buffer)\n",
+          page_write_cnt, write_req_cnt, page_read_cnt, buffer_read_cnt);
 }
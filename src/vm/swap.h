@@ -1,9 +1,13 @@
 #ifndef SWAP_H
 #define SWAP_H
 
+#include <stddef.h>
+
 void swap_init (void);
 size_t swap_out (void* page_idx);
 void swap_in (size_t aim_swap_page, void* page_idx);
 void swap_clear (size_t aim_swap_page);
+void swap_dup (size_t aim_swap_page);
+void swap_print_stats (void);
 
 #endif
\ No newline at end of file
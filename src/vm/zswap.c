@@ -0,0 +1,361 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+size_t zswap_pages = 64;
+
+/* The pool is divided into chunks, and a compressed page takes a
+   run of adjacent chunks. */
+#define CHUNK_SIZE 64
+
+/* Pages that do not compress to this size or smaller are not
+   worth the pool space and go straight to disk. */
+#define MAX_COMPRESSED (PGSIZE * 3 / 4)
+
+/* A compressed page. */
+struct zswap_entry
+  {
+    struct hash_elem hash_elem; /* Element in entries. */
+    struct list_elem lru_elem;  /* Element in lru. */
+    size_t slot;                /* Swap slot. */
+    size_t chunk;               /* First chunk in the pool. */
+    size_t length;              /* Compressed length, 0 if same-filled. */
+    uint32_t fill;              /* Repeated word, if same-filled. */
+  };
+
+static uint8_t *pool;           /* zswap_pages pages of chunks. */
+static struct bitmap *pool_map; /* Chunks in use. */
+static struct hash entries;     /* Entries by slot. */
+static struct list lru;         /* Entries, least recently stored first. */
+
+/* Compressor state, kept off the small kernel stack. */
+static uint8_t scratch[PGSIZE];
+static uint16_t lempel[1024];
+
+/* Statistics. */
+static long long store_cnt;         /* Pages stored. */
+static long long same_cnt;          /* Of those, same-filled. */
+static long long reject_cnt;        /* Pages that did not compress. */
+static long long full_cnt;          /* Pages refused for lack of room. */
+static long long writeback_cnt;     /* Pages written back to disk. */
+static long long hit_cnt;           /* Swap-ins served by the pool. */
+static long long miss_cnt;          /* Swap-ins that were not. */
+static long long stored_bytes;      /* Compressed size of stored pages. */
+
+static hash_hash_func entry_hash;
+static hash_less_func entry_less;
+
+void
+zswap_init (void)
+{
+  hash_init (&entries, entry_hash, entry_less, NULL);
+  list_init (&lru);
+  if (zswap_pages == 0)
+    return;
+
+  pool = palloc_get_multiple (0, zswap_pages);
+  if (pool == NULL)
+    {
+      printf ("zswap: cannot allocate %zu pages, disabled\n", zswap_pages);
+      return;
+    }
+  pool_map = bitmap_create (zswap_pages * PGSIZE / CHUNK_SIZE);
+  if (pool_map == NULL)
+    PANIC ("zswap: cannot allocate pool map");
+}
+
+/* LZJB-style compression.  The output is a series of groups of
+   up to eight items, each group preceded by a byte whose bits
+   tell whether the corresponding item is a literal byte or a
+   two-byte back reference of MATCH_BITS bits of length and the
+   rest of offset.  Back references are found through a hash of
+   the next three bytes. */
+#define MATCH_BITS 6
+#define MATCH_MIN 3
+#define MATCH_MAX ((1 << MATCH_BITS) + MATCH_MIN - 1)
+#define OFFSET_MASK ((1 << (16 - MATCH_BITS)) - 1)
+
+/* Compresses the page at SRC into DST.  Returns the compressed
+   length, or 0 if it would exceed LIMIT bytes. */
+static size_t
+compress (const uint8_t *src, uint8_t *dst, size_t limit)
+{
+  const uint8_t *s = src, *s_end = src + PGSIZE;
+  uint8_t *d = dst;
+  uint8_t *copymap = NULL;
+  int copymask = 1 << 7;
+
+  while (s < s_end)
+    {
+      const uint8_t *cpy;
+      size_t offset;
+      uint32_t hash;
+      uint16_t *hp;
+
+      if ((copymask <<= 1) == 1 << 8)
+        {
+          /* A group takes at most 1 + 8 * 2 bytes. */
+          if ((size_t) (d - dst) + 17 > limit)
+            return 0;
+          copymask = 1;
+          copymap = d;
+          *d++ = 0;
+        }
+      if (s > s_end - MATCH_MAX)
+        {
+          *d++ = *s++;
+          continue;
+        }
+
+      hash = (s[0] << 16) + (s[1] << 8) + s[2];
+      hash += hash >> 9;
+      hash += hash >> 5;
+      hp = &lempel[hash & (sizeof lempel / sizeof *lempel - 1)];
+      offset = (size_t) (s - src - *hp) & OFFSET_MASK;
+      *hp = s - src;
+      cpy = s - offset;
+      if (cpy >= src && cpy != s
+          && s[0] == cpy[0] && s[1] == cpy[1] && s[2] == cpy[2])
+        {
+          int length;
+
+          for (length = MATCH_MIN; length < MATCH_MAX; length++)
+            if (s[length] != cpy[length])
+              break;
+          *copymap |= copymask;
+          *d++ = ((length - MATCH_MIN) << (8 - MATCH_BITS)) | (offset >> 8);
+          *d++ = offset;
+          s += length;
+        }
+      else
+        *d++ = *s++;
+    }
+  return d - dst;
+}
+
+/* Decompresses LENGTH bytes at SRC into the page at DST. */
+static void
+decompress (const uint8_t *src, size_t length, uint8_t *dst)
+{
+  const uint8_t *s_end = src + length;
+  uint8_t *d = dst, *d_end = dst + PGSIZE;
+  int copymap = 0;
+  int copymask = 1 << 7;
+
+  while (d < d_end)
+    {
+      ASSERT (src < s_end);
+      if ((copymask <<= 1) == 1 << 8)
+        {
+          copymask = 1;
+          copymap = *src++;
+        }
+      if (copymap & copymask)
+        {
+          int match = (src[0] >> (8 - MATCH_BITS)) + MATCH_MIN;
+          size_t offset = ((src[0] << 8) | src[1]) & OFFSET_MASK;
+          const uint8_t *cpy = d - offset;
+
+          ASSERT (cpy >= dst && cpy < d);
+          src += 2;
+          while (match-- > 0 && d < d_end)
+            *d++ = *cpy++;
+        }
+      else
+        *d++ = *src++;
+    }
+}
+
+/* Returns true if PAGE consists of one 32-bit word repeated,
+   storing the word in *FILL. */
+static bool
+same_filled (const void *page, uint32_t *fill)
+{
+  const uint32_t *w = page;
+  size_t i;
+
+  for (i = 1; i < PGSIZE / sizeof *w; i++)
+    if (w[i] != w[0])
+      return false;
+  *fill = w[0];
+  return true;
+}
+
+/* Returns the entry for SLOT, or a null pointer if none. */
+static struct zswap_entry *
+lookup (size_t slot)
+{
+  struct zswap_entry key;
+  struct hash_elem *e;
+
+  key.slot = slot;
+  e = hash_find (&entries, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct zswap_entry, hash_elem) : NULL;
+}
+
+/* Decompresses entry E into PAGE. */
+static void
+load_entry (struct zswap_entry *e, void *page)
+{
+  if (e->length == 0)
+    {
+      uint32_t *w = page;
+      size_t i;
+
+      for (i = 0; i < PGSIZE / sizeof *w; i++)
+        w[i] = e->fill;
+    }
+  else
+    decompress (pool + e->chunk * CHUNK_SIZE, e->length, page);
+}
+
+/* Removes entry E from the pool and frees it. */
+static void
+remove_entry (struct zswap_entry *e)
+{
+  hash_delete (&entries, &e->hash_elem);
+  list_remove (&e->lru_elem);
+  if (e->length > 0)
+    bitmap_set_multiple (pool_map, e->chunk,
+                         DIV_ROUND_UP (e->length, CHUNK_SIZE), false);
+  free (e);
+}
+
+/* Writes back the least recently stored page through SPILL.
+   Returns false if there is none or SPILL refused it. */
+static bool
+write_back_lru (zswap_spill_func *spill)
+{
+  struct zswap_entry *e;
+  void *page;
+
+  if (list_empty (&lru))
+    return false;
+  e = list_entry (list_front (&lru), struct zswap_entry, lru_elem);
+  page = spill (e->slot);
+  if (page == NULL)
+    return false;
+  load_entry (e, page);
+  remove_entry (e);
+  writeback_cnt++;
+  return true;
+}
+
+/* Stores PAGE, which was swapped out to SLOT, in the pool,
+   writing back older pages through SPILL if there is no room.
+   Returns false if PAGE did not compress well or room could not
+   be made, in which case the caller must write it to disk. */
+bool
+zswap_store (size_t slot, const void *page, zswap_spill_func *spill)
+{
+  struct zswap_entry *e;
+
+  ASSERT (lookup (slot) == NULL);
+  if (pool == NULL)
+    return false;
+  e = malloc (sizeof *e);
+  if (e == NULL)
+    return false;
+
+  e->slot = slot;
+  if (same_filled (page, &e->fill))
+    {
+      e->length = 0;
+      same_cnt++;
+    }
+  else
+    {
+      size_t chunk_cnt;
+
+      e->length = compress (page, scratch, MAX_COMPRESSED);
+      if (e->length == 0)
+        {
+          reject_cnt++;
+          free (e);
+          return false;
+        }
+      chunk_cnt = DIV_ROUND_UP (e->length, CHUNK_SIZE);
+      while ((e->chunk = bitmap_scan_and_flip (pool_map, 0, chunk_cnt, false))
+             == BITMAP_ERROR)
+        if (!write_back_lru (spill))
+          {
+            full_cnt++;
+            free (e);
+            return false;
+          }
+      memcpy (pool + e->chunk * CHUNK_SIZE, scratch, e->length);
+      stored_bytes += e->length;
+    }
+  hash_insert (&entries, &e->hash_elem);
+  list_push_back (&lru, &e->lru_elem);
+  store_cnt++;
+  return true;
+}
+
+/* Copies the page stored for SLOT into PAGE.  Returns false if
+   the pool does not hold SLOT.  The entry stays until the slot
+   is freed, since other processes may still refer to it. */
+bool
+zswap_load (size_t slot, void *page)
+{
+  struct zswap_entry *e = lookup (slot);
+
+  if (e == NULL)
+    {
+      miss_cnt++;
+      return false;
+    }
+  load_entry (e, page);
+  hit_cnt++;
+  return true;
+}
+
+/* Drops the page stored for SLOT, if any, because the slot has
+   been freed. */
+void
+zswap_invalidate (size_t slot)
+{
+  struct zswap_entry *e = lookup (slot);
+
+  if (e != NULL)
+    remove_entry (e);
+}
+
+/* Prints compressed swap cache statistics. */
+void
+zswap_print_stats (void)
+{
+  printf ("Zswap: %lld pages stored (%lld same-filled), %lld rejected, "
+          "%lld refused, %lld written back\n",
+          store_cnt, same_cnt, reject_cnt, full_cnt, writeback_cnt);
+  printf ("Zswap: %lld hits, %lld misses, compressed to %lld%% of %lld kB\n",
+          hit_cnt, miss_cnt,
+          store_cnt > 0 ? stored_bytes * 100 / (store_cnt * PGSIZE) : 0,
+          store_cnt * PGSIZE / 1024);
+}
+
+/* Hash function for entries. */
+static unsigned
+entry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct zswap_entry *z = hash_entry (e, struct zswap_entry, hash_elem);
+  return hash_int (z->slot);
+}
+
+/* Orders entries by slot. */
+static bool
+entry_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct zswap_entry, hash_elem)->slot
+          < hash_entry (b, struct zswap_entry, hash_elem)->slot);
+}
@@ -0,0 +1,34 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Compressed swap cache.
+
+   Pages swapped out are first compressed into a pool of kernel
+   memory, keyed by the swap slot allocated for them, and reach
+   the swap disk only when the pool runs out of room, least
+   recently stored first.  Pages filled with a single repeated
+   word, most often zero, take no pool space at all.
+
+   The cache has no lock of its own: swap.c, its only user,
+   serializes all calls with its lock. */
+
+/* Number of kernel pages in the pool, 0 to disable the cache.
+   Controlled by kernel command-line option "-zswap=N". */
+extern size_t zswap_pages;
+
+/* Called when the pool is full to make room by writing back the
+   page stored for SLOT.  Returns the buffer that the page should
+   be decompressed into on its way to disk, or a null pointer if
+   it cannot be written back right now. */
+typedef void *zswap_spill_func (size_t slot);
+
+void zswap_init (void);
+bool zswap_store (size_t slot, const void *page, zswap_spill_func *);
+bool zswap_load (size_t slot, void *page);
+void zswap_invalidate (size_t slot);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */